@@ -0,0 +1,105 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/block_store.h"
+#include "../src/config.h"
+#include "../src/mesher.h"
+#include "../src/world.h"
+
+// A/B of the two chunk block stores on generated terrain: memory per chunk,
+// generation (set) throughput, random get, full iteration and meshing time.
+
+#define RADIUS 2
+#define SIDE (RADIUS * 2 + 1)
+#define GETS 4000000
+
+static void _set_func(int x, int y, int z, int w, void *arg) {
+    block_store_set((BlockStore *)arg, x, y, z, w);
+}
+
+static void run(BlockStoreType type, const char *name) {
+    static BlockStore stores[SIDE][SIDE];
+    double start = bench_now();
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            int p = a - RADIUS;
+            int q = b - RADIUS;
+            block_store_alloc(&stores[a][b], type,
+                p * CHUNK_SIZE - 1, 0, q * CHUNK_SIZE - 1);
+            create_world(p, q, _set_func, &stores[a][b]);
+        }
+    }
+    double generate = (bench_now() - start) * 1000 / (SIDE * SIDE);
+
+    size_t memory = 0;
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            memory += block_store_memory_usage(&stores[a][b]);
+        }
+    }
+
+    BlockStore *center = &stores[RADIUS][RADIUS];
+    unsigned int seed = 777;
+    long checksum = 0;
+    start = bench_now();
+    for (int i = 0; i < GETS; i++) {
+        unsigned int r = bench_rand(&seed);
+        int x = r % CHUNK_SIZE;
+        int y = (r >> 8) % 96;
+        int z = (r >> 16) % CHUNK_SIZE;
+        checksum += block_store_get(center, x, y, z);
+    }
+    double get = (bench_now() - start) * 1e9 / GETS;
+
+    long blocks = 0;
+    start = bench_now();
+    for (int i = 0; i < 100; i++) {
+        BLOCK_STORE_FOR_EACH(center, ex, ey, ez, ew) {
+            blocks++;
+            checksum += ew;
+        } END_BLOCK_STORE_FOR_EACH;
+    }
+    double iterate = (bench_now() - start) * 1000 / 100;
+
+    int faces = 0;
+    start = bench_now();
+    int meshed = 0;
+    for (int a = 1; a < SIDE - 1; a++) {
+        for (int b = 1; b < SIDE - 1; b++) {
+            MesherInput input = {0};
+            input.p = a - RADIUS;
+            input.q = b - RADIUS;
+            input.sections = MESHER_ALL_SECTIONS;
+            for (int da = -1; da <= 1; da++) {
+                for (int db = -1; db <= 1; db++) {
+                    input.block[da + 1][db + 1] = &stores[a + da][b + db];
+                }
+            }
+            MesherOutput *output = mesher_compute_chunk(&input);
+            faces += output->faces;
+            mesher_free_output(&output);
+            meshed++;
+        }
+    }
+    double mesh = (bench_now() - start) * 1000 / meshed;
+
+    printf("%-9s %9.1f KB %11.2f ms %9.1f ns %10.2f ms %9.2f ms %9d\n",
+        name, memory / 1024.0 / (SIDE * SIDE), generate, get,
+        iterate, mesh, faces / meshed);
+    if (checksum == 42) {
+        printf("\n");
+    }
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            block_store_free(&stores[a][b]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    printf("%-9s %12s %14s %12s %13s %12s %9s\n",
+        "store", "mem/chunk", "generate", "get", "iterate", "mesh", "faces");
+    run(BLOCK_STORE_MAP, "map");
+    run(BLOCK_STORE_SECTIONS, "sections");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/chunk_index.h"
+
+// Compares the old linear chunk_manager_find_chunk scan against ChunkIndex
+// for growing chunk counts. Chunks are laid out in a square around the
+// origin like the chunk manager keeps them, lookups hit the 3x3 neighborhood
+// of random resident chunks (what _set_block and the mesher inputs do).
+
+#define LOOKUPS 2000000
+
+typedef struct {
+    int p, q;
+} Key;
+
+static int linear_find(Key *keys, int count, int p, int q) {
+    for (int i = 0; i < count; i++) {
+        if (keys[i].p == p && keys[i].q == q) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    static const int counts[] = {64, 256, 1024, 4096, 8192};
+    printf("%8s %14s %14s %10s\n", "chunks", "linear ns/op", "index ns/op", "speedup");
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); c++) {
+        int count = counts[c];
+        int side = 1;
+        while (side * side < count) {
+            side++;
+        }
+        Key *keys = malloc(sizeof(Key) * count);
+        ChunkIndex index;
+        chunk_index_alloc(&index, 0xff);
+        for (int i = 0; i < count; i++) {
+            keys[i].p = i % side - side / 2;
+            keys[i].q = i / side - side / 2;
+            chunk_index_set(&index, keys[i].p, keys[i].q, i);
+        }
+        int lookups = count >= 4096 ? LOOKUPS / 20 : LOOKUPS / 4;
+        unsigned int seed = 12345;
+        long checksum = 0;
+        double start = bench_now();
+        for (int i = 0; i < lookups; i++) {
+            Key *k = keys + bench_rand(&seed) % count;
+            int dp = (int)(bench_rand(&seed) % 3) - 1;
+            checksum += linear_find(keys, count, k->p + dp, k->q);
+        }
+        double linear = (bench_now() - start) * 1e9 / lookups;
+        seed = 12345;
+        start = bench_now();
+        for (int i = 0; i < lookups; i++) {
+            Key *k = keys + bench_rand(&seed) % count;
+            int dp = (int)(bench_rand(&seed) % 3) - 1;
+            checksum -= chunk_index_get(&index, k->p + dp, k->q);
+        }
+        double indexed = (bench_now() - start) * 1e9 / lookups;
+        if (checksum != 0) {
+            fprintf(stderr, "index and linear scan disagree\n");
+            return 1;
+        }
+        printf("%8d %14.1f %14.1f %9.1fx\n",
+            count, linear, indexed, linear / indexed);
+        chunk_index_free(&index);
+        free(keys);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/mesher.c" // the mask pass and scratch layout are static
+#include "../src/world.h"
+
+// Exposed face detection of the mesher on generated terrain: six probes of
+// the byte per voxel opaque array for every block of the chunk, as the
+// mesher used to do, against the column bitmasks it builds now and
+// _column_faces. Building the masks, from the opaque array and one walk
+// over the chunk's store, is timed on its own. Both ways run on the same
+// filled opaque array and must find the same faces, block by block.
+
+#define RADIUS 3
+#define SIDE (RADIUS * 2 + 1)
+#define ROUNDS 5
+
+static BlockStore stores[SIDE][SIDE];
+static ColumnMask found[2][6][COLUMN_SIDE * COLUMN_SIDE]; // probes, masks
+
+static int count_bits(uint64_t bits) {
+    int count = 0;
+    for (; bits; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+static void _set_func(int x, int y, int z, int w, void *arg) {
+    block_store_set((BlockStore *)arg, x, y, z, w);
+}
+
+// the opaque array of the chunk at a, b and its neighbors, as the mesher
+// fills it
+static void fill_opaque(MesherScratch *scratch, int a, int b, int ox, int oz) {
+    for (int da = -1; da <= 1; da++) {
+        for (int db = -1; db <= 1; db++) {
+            BLOCK_STORE_FOR_EACH(&stores[a + da][b + db], ex, ey, ez, ew) {
+                int x = ex - ox;
+                int y = ey + 1;
+                int z = ez - oz;
+                if (x < 0 || z < 0 || x >= XZ_SIZE || z >= XZ_SIZE) {
+                    continue;
+                }
+                scratch->opaque[XYZ(x, y, z)] = !is_transparent(ew);
+                scratch->opaque_miny = MIN(scratch->opaque_miny, y);
+                scratch->opaque_maxy = MAX(scratch->opaque_maxy, y);
+            } END_BLOCK_STORE_FOR_EACH;
+        }
+    }
+}
+
+static void detect_probes(MesherScratch *scratch, BlockStore *blocks, int cx, int cz, int ox, int oz) {
+    char *opaque = scratch->opaque;
+    BLOCK_STORE_FOR_EACH(blocks, ex, ey, ez, ew) {
+        int lx = ex - cx;
+        int lz = ez - cz;
+        if (ew <= 0 || lx < 0 || lz < 0 || lx >= CHUNK_SIZE || lz >= CHUNK_SIZE) {
+            continue;
+        }
+        int x = ex - ox;
+        int y = ey + 1;
+        int z = ez - oz;
+        int f[6];
+        f[0] = !opaque[XYZ(x - 1, y, z)];
+        f[1] = !opaque[XYZ(x + 1, y, z)];
+        f[2] = !opaque[XYZ(x, y + 1, z)];
+        f[3] = !opaque[XYZ(x, y - 1, z)] && (ey > 0);
+        f[4] = !opaque[XYZ(x, y, z - 1)];
+        f[5] = !opaque[XYZ(x, y, z + 1)];
+        for (int i = 0; i < 6; i++) {
+            found[0][i][COLUMN(lx, lz)][ey >> 6] |= (uint64_t)f[i] << (ey & 63);
+        }
+    } END_BLOCK_STORE_FOR_EACH;
+}
+
+static void build_masks(MesherScratch *scratch, BlockStore *blocks, int cx, int cz, int ox, int oz) {
+    int column_miny = MAX(scratch->opaque_miny - 1, 0);
+    int column_maxy = MIN(scratch->opaque_maxy - 1, 255);
+    for (int ey = column_miny; ey <= column_maxy; ey++) {
+        for (int lx = -1; lx <= CHUNK_SIZE; lx++) {
+            const char *row = scratch->opaque + XYZ(cx + lx - ox, ey + 1, cz - 1 - oz);
+            ColumnMask *solid = scratch->solid + COLUMN(lx, -1);
+            for (int lz = 0; lz < COLUMN_SIDE; lz++) {
+                solid[lz][ey >> 6] |= (uint64_t)row[lz] << (ey & 63);
+            }
+        }
+    }
+    BLOCK_STORE_FOR_EACH(blocks, ex, ey, ez, ew) {
+        int lx = ex - cx;
+        int lz = ez - cz;
+        if (ew <= 0 || lx < 0 || lz < 0 || lx >= CHUNK_SIZE || lz >= CHUNK_SIZE) {
+            continue;
+        }
+        scratch->present[COLUMN(lx, lz)][ey >> 6] |= (uint64_t)1 << (ey & 63);
+    } END_BLOCK_STORE_FOR_EACH;
+}
+
+static void detect_masks(MesherScratch *scratch) {
+    for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+        for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+            for (int word = 0; word < COLUMN_WORDS; word++) {
+                uint64_t exposed[6];
+                _column_faces(scratch, lx, lz, word, exposed);
+                for (int i = 0; i < 6; i++) {
+                    found[1][i][COLUMN(lx, lz)][word] = exposed[i];
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            int p = a - RADIUS;
+            int q = b - RADIUS;
+            block_store_alloc(&stores[a][b], BLOCK_STORE_SECTIONS,
+                p * CHUNK_SIZE - 1, 0, q * CHUNK_SIZE - 1);
+            create_world(p, q, _set_func, &stores[a][b]);
+        }
+    }
+    MesherScratch *scratch = mesher_scratch_create();
+    double seconds[3] = {0, 0, 0}; // probes, building the masks, _column_faces
+    long faces = 0;
+    int mismatches = 0;
+    int chunks = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int a = 1; a < SIDE - 1; a++) {
+            for (int b = 1; b < SIDE - 1; b++) {
+                int cx = (a - RADIUS) * CHUNK_SIZE;
+                int cz = (b - RADIUS) * CHUNK_SIZE;
+                int ox = cx - CHUNK_SIZE - 1;
+                int oz = cz - CHUNK_SIZE - 1;
+                BlockStore *blocks = &stores[a][b];
+                fill_opaque(scratch, a, b, ox, oz);
+                memset(found, 0, sizeof(found));
+                double times[4];
+                times[0] = bench_now();
+                detect_probes(scratch, blocks, cx, cz, ox, oz);
+                times[1] = bench_now();
+                build_masks(scratch, blocks, cx, cz, ox, oz);
+                times[2] = bench_now();
+                detect_masks(scratch);
+                times[3] = bench_now();
+                for (int i = 0; i < 3; i++) {
+                    seconds[i] += times[i + 1] - times[i];
+                }
+                for (int i = 0; i < 6; i++) {
+                    for (int c = 0; c < COLUMN_SIDE * COLUMN_SIDE; c++) {
+                        for (int word = 0; word < COLUMN_WORDS; word++) {
+                            uint64_t probes = found[0][i][c][word];
+                            faces += count_bits(probes);
+                            mismatches += count_bits(probes ^ found[1][i][c][word]);
+                        }
+                    }
+                }
+                _clear_y_range(scratch->opaque, scratch->opaque_miny, scratch->opaque_maxy);
+                memset(scratch->solid, 0, sizeof(ColumnMask) * COLUMN_SIDE * COLUMN_SIDE);
+                memset(scratch->present, 0, sizeof(ColumnMask) * COLUMN_SIDE * COLUMN_SIDE);
+                scratch->opaque_miny = Y_SIZE;
+                scratch->opaque_maxy = -1;
+                chunks++;
+            }
+        }
+    }
+    printf("%-8s %9s %12s %12s %12s\n", "detect", "faces", "build", "detect", "total");
+    printf("%-8s %9ld %12s %9.3f ms %9.3f ms\n", "probes", faces / chunks, "-",
+        seconds[0] * 1000 / chunks, seconds[0] * 1000 / chunks);
+    printf("%-8s %9ld %9.3f ms %9.3f ms %9.3f ms\n", "masks", faces / chunks,
+        seconds[1] * 1000 / chunks, seconds[2] * 1000 / chunks,
+        (seconds[1] + seconds[2]) * 1000 / chunks);
+    if (mismatches) {
+        printf("%d faces differ between the two ways\n", mismatches);
+    }
+    mesher_scratch_destroy(scratch);
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            block_store_free(&stores[a][b]);
+        }
+    }
+    return 0;
+}
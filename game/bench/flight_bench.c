@@ -0,0 +1,149 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/camera.h"
+#include "../src/chunk_manager.h"
+#include "../src/config.h"
+#include "../src/thread_pool.h"
+#include "../src/time.h"
+
+// Flies a fixed path at flying speed through a fresh world, once without
+// and once with path prediction, and counts how often the chunk manager had
+// to mesh on the main thread because the chunks around the player were not
+// ready in time. Runs in real time at 60 frames per second so the worker
+// pool gets the same time per frame as in the game. The renderer and the
+// GLFW clock are replaced below, everything else is the real chunk manager.
+
+#define FPS 60
+#define FLYING_SPEED 20.0f // blocks per second, as in player_update_pos
+#define WARMUP_SECONDS 30
+
+typedef struct {
+    float heading; // degrees, 0 flies towards -z like the player's rx
+    float seconds;
+} Leg;
+
+static const Leg path[] = {
+    {90, 4}, {135, 3}, {180, 3}, {90, 2}, {45, 3}, {90, 3}
+};
+
+// stand-ins for the GL and GLFW side
+void renderer_upload_chunk_geometry(
+    Renderer *renderer, RenderableObjectID *id_ptr, MesherOutput *mesh_data)
+{
+    static int next_id = 0;
+    if (*id_ptr == INVALID_RENDERABLE_OBJECT_ID) {
+        *id_ptr = next_id++;
+    }
+}
+void renderer_delete_chunk_geometry(Renderer *renderer, RenderableObjectID id) {
+}
+void time_init() {
+}
+double time_get_seconds() {
+    return bench_now();
+}
+
+static void set_camera(Camera *view, float x, float z, float heading) {
+    view->window_width = 1024;
+    view->window_height = 768;
+    view->fov = 65;
+    view->ortho = 0;
+    view->x = x;
+    view->y = 80;
+    view->z = z;
+    view->rx = heading * 3.14159265f / 180;
+    view->ry = 0;
+    view->render_radius = RENDER_CHUNK_RADIUS;
+    camera_update_matrices(view);
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static void run(float speed, float prefetch_seconds) {
+    ChunkManagerConfig config = {
+        .create_radius = CREATE_CHUNK_RADIUS,
+        .render_radius = RENDER_CHUNK_RADIUS,
+        .delete_radius = DELETE_CHUNK_RADIUS,
+        .sign_radius = RENDER_SIGN_RADIUS,
+        .block_store = BLOCK_STORE_SECTIONS,
+        .cache_memory = 0, // every chunk on the path is new
+        .prefetch_seconds = prefetch_seconds,
+    };
+    ChunkManager *manager = chunk_manager_create(&config);
+    ChunkManagerStats stats;
+    Camera view;
+    float x = 0;
+    float z = 0;
+    float heading = path[0].heading;
+
+    // settle at the start so both runs begin with the same world
+    set_camera(&view, x, z, heading);
+    chunk_manager_force_chunks_around_point(manager, NULL, x, z);
+    double start = bench_now();
+    do {
+        chunk_manager_update(manager, &view, NULL);
+        bench_sleep(1.0 / FPS);
+        chunk_manager_get_stats(manager, &stats);
+    } while (bench_now() - start < WARMUP_SECONDS &&
+        (stats.queued_chunks || stats.stages[CHUNK_STAGE_GENERATE].depth ||
+            stats.stages[CHUNK_STAGE_MESH].depth || stats.stages[CHUNK_STAGE_UPLOAD].depth));
+    unsigned int forced_before = stats.forced_meshes;
+
+    int frames = 0;
+    int forcing_frames = 0;
+    int capacity = 0;
+    for (size_t i = 0; i < sizeof(path) / sizeof(path[0]); i++) {
+        capacity += (int)(path[i].seconds * FPS) + 1;
+    }
+    float *update_ms = (float *)malloc(sizeof(float) * capacity);
+    for (size_t i = 0; i < sizeof(path) / sizeof(path[0]); i++) {
+        heading = path[i].heading;
+        float radians = heading * 3.14159265f / 180;
+        float vx = sinf(radians) * speed;
+        float vz = -cosf(radians) * speed;
+        int leg_frames = (int)(path[i].seconds * FPS);
+        for (int f = 0; f < leg_frames; f++) {
+            double frame_start = bench_now();
+            x += vx / FPS;
+            z += vz / FPS;
+            set_camera(&view, x, z, heading);
+            unsigned int forced = stats.forced_meshes;
+            chunk_manager_set_motion(manager, vx, vz);
+            chunk_manager_delete_distant_chunks(manager, NULL, x, z);
+            chunk_manager_update(manager, &view, NULL);
+            update_ms[frames++] = (float)((bench_now() - frame_start) * 1000);
+            chunk_manager_get_stats(manager, &stats);
+            forcing_frames += stats.forced_meshes != forced;
+            bench_sleep(1.0 / FPS - (bench_now() - frame_start));
+        }
+    }
+    qsort(update_ms, frames, sizeof(float), compare_floats);
+    printf("%10s %10u %14d %10.2f %10.2f\n",
+        prefetch_seconds ? "predicted" : "distance",
+        stats.forced_meshes - forced_before, forcing_frames,
+        update_ms[frames / 2], update_ms[(int)(frames * 0.99f)]);
+    free(update_ms);
+    chunk_manager_destroy(manager, NULL);
+}
+
+// usage: flight_bench [speed in blocks per second]
+int main(int argc, char **argv) {
+    float speed = argc > 1 ? (float)atof(argv[1]) : FLYING_SPEED;
+    float seconds = 0;
+    for (size_t i = 0; i < sizeof(path) / sizeof(path[0]); i++) {
+        seconds += path[i].seconds;
+    }
+    printf("%.0f s of flight at %.0f blocks/s, create radius %d, %d hardware threads\n",
+        seconds, speed, CREATE_CHUNK_RADIUS, thread_pool_hardware_threads());
+    printf("%10s %10s %14s %10s %10s\n",
+        "schedule", "forced", "forcing frames", "p50 ms", "p99 ms");
+    run(speed, 0);
+    run(speed, PREFETCH_SECONDS);
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/chunk_manager.h"
+#include "../src/config.h"
+#include "../src/item.h"
+#include "../src/util.h"
+
+// Random light toggles and block edits next to the lights, in the real
+// chunk manager, each applied by the incremental lighting passes. Every
+// CHECK_EVERY edits the light levels of the loaded area are compared with
+// a flood fill of all its sources from scratch; the cells that differ must
+// stay 0. Last, the time one torch toggle in open air takes.
+
+#define AREA_CHUNKS 5 // square of chunks around chunk (0, 0)
+#define LOW (-(AREA_CHUNKS / 2) * CHUNK_SIZE)
+#define SIDE (AREA_CHUNKS * CHUNK_SIZE)
+#define HEIGHT 128
+#define EDITS 400
+#define CHECK_EVERY 40
+#define MAX_LIGHTS 64
+#define TOGGLES 200
+
+// the flood fill's picture of the area, indexed [x][y][z] from LOW
+static signed char levels[SIDE][HEIGHT][SIDE];
+static char opaque[SIDE][HEIGHT][SIDE];
+static char loaded[SIDE][SIDE];
+
+// stand-ins for the GL and GLFW side
+void renderer_upload_chunk_geometry(
+    Renderer *renderer, RenderableObjectID *id_ptr, MesherOutput *mesh_data)
+{
+    if (*id_ptr == INVALID_RENDERABLE_OBJECT_ID) {
+        *id_ptr = 1;
+    }
+}
+void renderer_delete_chunk_geometry(Renderer *renderer, RenderableObjectID id) {
+}
+void time_init() {
+}
+double time_get_seconds() {
+    return bench_now();
+}
+
+static Chunk *find_column(ChunkManager *manager, int x, int z) {
+    return chunk_manager_find_chunk(manager, chunked(x + LOW), chunked(z + LOW));
+}
+
+// light spreads one level down per step through transparent cells of
+// loaded chunks, brightest first so every cell is set once
+static void flood(ChunkManager *manager) {
+    memset(levels, 0, sizeof(levels));
+    for (int x = 0; x < SIDE; x++) {
+        for (int z = 0; z < SIDE; z++) {
+            Chunk *chunk = find_column(manager, x, z);
+            loaded[x][z] = chunk && chunk->loaded;
+            for (int y = 0; y < HEIGHT; y++) {
+                opaque[x][y][z] = loaded[x][z] &&
+                    !is_transparent(block_store_get(&chunk->blocks, x + LOW, y, z + LOW));
+                if (loaded[x][z]) {
+                    levels[x][y][z] = map_get(&chunk->lights, x + LOW, y, z + LOW);
+                }
+            }
+        }
+    }
+    static const int offsets[6][3] = {
+        {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
+    };
+    for (int level = 15; level > 1; level--) {
+        for (int x = 0; x < SIDE; x++) {
+            for (int y = 0; y < HEIGHT; y++) {
+                for (int z = 0; z < SIDE; z++) {
+                    if (levels[x][y][z] != level) {
+                        continue;
+                    }
+                    for (int i = 0; i < 6; i++) {
+                        int nx = x + offsets[i][0];
+                        int ny = y + offsets[i][1];
+                        int nz = z + offsets[i][2];
+                        if (nx < 0 || ny < 0 || nz < 0 ||
+                            nx >= SIDE || ny >= HEIGHT || nz >= SIDE)
+                        {
+                            continue;
+                        }
+                        if (!loaded[nx][nz] || opaque[nx][ny][nz] ||
+                            levels[nx][ny][nz] >= level - 1)
+                        {
+                            continue;
+                        }
+                        levels[nx][ny][nz] = level - 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// cells whose kept level differs from the flood fill
+static int compare(ChunkManager *manager, long *lit) {
+    flood(manager);
+    int mismatches = 0;
+    *lit = 0;
+    for (int x = 0; x < SIDE; x++) {
+        for (int z = 0; z < SIDE; z++) {
+            if (!loaded[x][z]) {
+                continue;
+            }
+            Chunk *chunk = find_column(manager, x, z);
+            for (int y = 0; y < HEIGHT; y++) {
+                int level = map_get(&chunk->light_levels, x + LOW, y, z + LOW);
+                mismatches += level != levels[x][y][z];
+                *lit += levels[x][y][z] > 0;
+            }
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char **argv) {
+    ChunkManagerConfig config = {
+        .create_radius = AREA_CHUNKS / 2,
+        .render_radius = AREA_CHUNKS / 2,
+        .delete_radius = AREA_CHUNKS,
+        .sign_radius = 1,
+        .block_store = BLOCK_STORE_SECTIONS,
+        .cache_memory = 0,
+        .prefetch_seconds = 0,
+    };
+    ChunkManager *manager = chunk_manager_create(&config);
+    // the middle 3x3 chunks and their neighbors, so edits near the edge of
+    // the middle spread into loaded chunks and stop at unloaded ones
+    for (int p = -1; p <= 1; p++) {
+        for (int q = -1; q <= 1; q++) {
+            chunk_manager_force_chunks_around_point(
+                manager, NULL, p * CHUNK_SIZE + 5, q * CHUNK_SIZE + 5);
+        }
+    }
+    printf("%8s %8s %12s\n", "edits", "lit", "cells differ");
+    long lit;
+    int mismatches = compare(manager, &lit);
+    printf("%8d %8ld %12d\n", 0, lit, mismatches);
+    int lights[MAX_LIGHTS][3];
+    int light_count = 0;
+    unsigned int seed = 1234;
+    for (int edit = 1; edit <= EDITS; edit++) {
+        unsigned int kind = bench_rand(&seed) % 4;
+        int x = (int)(bench_rand(&seed) % 100) - 50;
+        int z = (int)(bench_rand(&seed) % 100) - 50;
+        int y = 25 + bench_rand(&seed) % 30;
+        if (kind == 0 || !light_count) {
+            // a new torch, possibly inside a block
+            chunk_manager_toggle_light(manager, x, y, z);
+            if (light_count < MAX_LIGHTS) {
+                lights[light_count][0] = x;
+                lights[light_count][1] = y;
+                lights[light_count][2] = z;
+                light_count++;
+            }
+        }
+        else if (kind == 1) {
+            // an earlier torch toggled again
+            int *light = lights[bench_rand(&seed) % light_count];
+            chunk_manager_toggle_light(manager, light[0], light[1], light[2]);
+        }
+        else {
+            // a block mined or placed near a torch
+            int *light = lights[bench_rand(&seed) % light_count];
+            int bx = light[0] + (int)(bench_rand(&seed) % 9) - 4;
+            int by = light[1] + (int)(bench_rand(&seed) % 9) - 4;
+            int bz = light[2] + (int)(bench_rand(&seed) % 9) - 4;
+            chunk_manager_set_block(manager, bx, by, bz, kind == 2 ? 0 : 3);
+        }
+        if (edit % CHECK_EVERY == 0) {
+            int differ = compare(manager, &lit);
+            printf("%8d %8ld %12d\n", edit, lit, differ);
+            mismatches += differ;
+        }
+    }
+    if (mismatches) {
+        printf("%d cells differ from the flood fill\n", mismatches);
+    }
+    double start = bench_now();
+    for (int i = 0; i < TOGGLES; i++) {
+        chunk_manager_toggle_light(manager, 3, 90, 3);
+    }
+    printf("toggle in open air %.3f ms\n", (bench_now() - start) * 1000 / TOGGLES);
+    chunk_manager_destroy(manager, NULL);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/config.h"
+#include "../src/map.h"
+
+// Lookup throughput of the Map at the load factors it runs at, up to the
+// half full table where map_set grows it. Keys are chunk blocks: x and z in
+// the chunk and its border, any y. Hits look up stored keys, misses keys of
+// the same chunk that were never stored, like collision and hit tests in
+// the air do. Build once with MAP_SIMD_PROBING 0 in config.h to compare
+// against scalar probing.
+//
+// Then the latency of single map_set calls while a chunk's worth of blocks
+// goes into a small map, which grows several times on the way, and into one
+// presized with map_reserve. Growing moves MAP_REHASH_STEP slots per call,
+// so the slowest call stays far from the cost of a whole rehash: about
+// 60 us here against 1.3 ms when a resize rehashed everything at once. The
+// price is paid by many more calls, though. Every map_set while a resize
+// is in flight does a step of it, and p99.9 of "growing" rose from about
+// 200 ns with whole rehashes to about 4 us. Chunk maps avoid both by being
+// presized, see "reserved".
+
+#define MASK 0x7fff // BLOCK_STORE_MAP_MASK
+#define SIDE (CHUNK_SIZE + 2)
+#define LOOKUPS 4000000
+#define ROUNDS 5
+#define FILL (SIDE * SIDE * 48) // blocks of a chunk with some terrain
+#define FILL_MASK 0xff // BLOCK_STORE_MAP_MASK
+
+typedef struct {
+    int x, y, z;
+} Key;
+
+static double lookup(Map *map, const Key *keys, int count, long *checksum) {
+    double best = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        unsigned int seed = 12345;
+        double start = bench_now();
+        for (int i = 0; i < LOOKUPS; i++) {
+            const Key *k = keys + bench_rand(&seed) % count;
+            *checksum += map_get(map, k->x, k->y, k->z);
+        }
+        double ns = (bench_now() - start) * 1e9 / LOOKUPS;
+        best = round && best < ns ? best : ns;
+    }
+    return best;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void fill(const Key *keys, double *times, int reserve, const char *name) {
+    double worst = 0;
+    double tail = 0;
+    double total = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        Map map;
+        map_alloc(&map, -1, 0, -1, FILL_MASK);
+        if (reserve) {
+            map_reserve(&map, FILL);
+        }
+        for (int i = 0; i < FILL; i++) {
+            double start = bench_now();
+            map_set(&map, keys[i].x, keys[i].y, keys[i].z, 1 + i % 64);
+            times[i] = bench_now() - start;
+        }
+        map_free(&map);
+        // the best round's tail, the others include whatever else ran
+        qsort(times, FILL, sizeof(double), compare_doubles);
+        double slowest = times[FILL - 1];
+        if (!round || slowest < worst) {
+            worst = slowest;
+            tail = times[FILL - FILL / 1000];
+            total = 0;
+            for (int i = 0; i < FILL; i++) {
+                total += times[i];
+            }
+        }
+    }
+    printf("%-10s %8d %10.1f %10.1f %10.1f\n", name, FILL,
+        total * 1e9 / FILL, tail * 1e9, worst * 1e6);
+}
+
+int main(int argc, char **argv) {
+    static const float loads[] = {0.125f, 0.25f, 0.375f, 0.5f};
+    int cells = SIDE * SIDE * 256;
+    Key *all = malloc(sizeof(Key) * cells);
+    for (int i = 0; i < cells; i++) {
+        all[i].x = i % SIDE - 1;
+        all[i].z = i / SIDE % SIDE - 1;
+        all[i].y = i / (SIDE * SIDE);
+    }
+    unsigned int seed = 777;
+    for (int i = cells - 1; i > 0; i--) {
+        int j = bench_rand(&seed) % (i + 1);
+        Key t = all[i];
+        all[i] = all[j];
+        all[j] = t;
+    }
+#if !MAP_SIMD_PROBING
+    const char *probing = "scalar";
+#elif defined(__AVX2__)
+    const char *probing = "AVX2, 8 slots";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const char *probing = "SSE2, 4 slots";
+#else
+    const char *probing = "scalar";
+#endif
+    printf("probing: %s\n", probing);
+    printf("%6s %8s %12s %12s\n", "load", "entries", "hit ns/op", "miss ns/op");
+    long checksum = 0;
+    for (int l = 0; l < (int)(sizeof(loads) / sizeof(loads[0])); l++) {
+        int count = (int)(loads[l] * (MASK + 1));
+        if (count * 2 > MASK) {
+            count = MASK / 2; // one more and the table grows
+        }
+        Map map;
+        map_alloc(&map, -1, 0, -1, MASK);
+        for (int i = 0; i < count; i++) {
+            map_set(&map, all[i].x, all[i].y, all[i].z, 1 + i % 64);
+        }
+        double hit = lookup(&map, all, count, &checksum);
+        double miss = lookup(&map, all + count, count, &checksum);
+        printf("%6.3f %8d %12.2f %12.2f\n",
+            (float)map.size / (map.mask + 1), map.size, hit, miss);
+        map_free(&map);
+    }
+    printf("checksum %ld\n", checksum);
+    printf("\n%-10s %8s %10s %10s %10s\n",
+        "map_set", "blocks", "mean ns", "p99.9 ns", "worst us");
+    double *times = malloc(sizeof(double) * FILL);
+    fill(all, times, 0, "growing");
+    fill(all, times, 1, "reserved");
+    free(times);
+    free(all);
+    return 0;
+}
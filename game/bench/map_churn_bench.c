@@ -0,0 +1,101 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/config.h"
+#include "../src/map.h"
+
+// A long session of edits on one chunk's block Map: mining that removes
+// blocks and places others elsewhere, then /fill style clears of whole
+// layers. Every REPORT edits prints the table size and the probe lengths a
+// lookup sees: the mean slots a miss walks from a random home slot, and the
+// longest run of occupied slots, which bounds every probe. Removed blocks
+// free their slots, so both stay flat however long the session runs, and
+// the table shrinks back once the clears empty it.
+
+#define MASK 0x7fff // BLOCK_STORE_MAP_MASK
+#define SIDE (CHUNK_SIZE + 2)
+#define GROUND 16 // generated terrain fills y below this
+#define HEIGHT 128 // mining places blocks up to here
+#define EDITS 2000000
+#define REPORT 250000
+#define LOOKUPS 1000000
+
+static void report(Map *map, long edits, const char *phase) {
+    // walk backwards so each slot knows the run of occupied slots after it
+    unsigned int slots = map->mask + 1;
+    unsigned int run = 0;
+    unsigned int longest = 0;
+    double probes = 0;
+    for (unsigned int i = 0; i < slots * 2; i++) {
+        MapEntry *entry = map->data + (slots * 2 - 1 - i) % slots;
+        run = EMPTY_ENTRY(entry) ? 0 : run + 1;
+        if (i >= slots) {
+            probes += run + 1;
+            longest = run > longest ? run : longest;
+        }
+    }
+    unsigned int seed = 4242;
+    long checksum = 0;
+    double start = bench_now();
+    for (int i = 0; i < LOOKUPS; i++) {
+        int x = bench_rand(&seed) % SIDE - 1;
+        int z = bench_rand(&seed) % SIDE - 1;
+        int y = bench_rand(&seed) % HEIGHT;
+        checksum += map_get(map, x, y, z);
+    }
+    double ns = (bench_now() - start) * 1e9 / LOOKUPS;
+    printf("%-6s %8ld %8u %8u %6.3f %10.2f %8u %8.2f %6ld\n",
+        phase, edits, map->size, slots, (float)map->size / slots,
+        probes / slots, longest, ns, checksum % 1000);
+}
+
+int main(int argc, char **argv) {
+    Map map;
+    map_alloc(&map, -1, 0, -1, MASK);
+    for (int x = -1; x < SIDE - 1; x++) {
+        for (int z = -1; z < SIDE - 1; z++) {
+            for (int y = 0; y < GROUND; y++) {
+                map_set(&map, x, y, z, 1 + y % 8);
+            }
+        }
+    }
+    printf("%-6s %8s %8s %8s %6s %10s %8s %8s %6s\n",
+        "phase", "edits", "entries", "slots", "load", "miss probe",
+        "longest", "get ns", "check");
+    report(&map, 0, "start");
+    unsigned int seed = 12345;
+    long edits = 0;
+    while (edits < EDITS) {
+        // mine a block and place one somewhere in the air, so the count of
+        // blocks holds steady while the cells touched keep spreading out
+        int x = bench_rand(&seed) % SIDE - 1;
+        int z = bench_rand(&seed) % SIDE - 1;
+        int y = bench_rand(&seed) % HEIGHT;
+        if (map_get(&map, x, y, z)) {
+            map_set(&map, x, y, z, 0);
+            do {
+                x = bench_rand(&seed) % SIDE - 1;
+                z = bench_rand(&seed) % SIDE - 1;
+                y = bench_rand(&seed) % HEIGHT;
+            } while (map_get(&map, x, y, z));
+            map_set(&map, x, y, z, 1 + y % 8);
+            edits += 2;
+            if (edits % REPORT == 0) {
+                report(&map, edits, "mine");
+            }
+        }
+    }
+    for (int y = HEIGHT - 1; y >= 0; y -= 16) {
+        for (int dy = 0; dy < 16; dy++) {
+            for (int x = -1; x < SIDE - 1; x++) {
+                for (int z = -1; z < SIDE - 1; z++) {
+                    map_set(&map, x, y - dy, z, 0);
+                    edits++;
+                }
+            }
+        }
+        report(&map, edits, "clear");
+    }
+    map_free(&map);
+    return 0;
+}
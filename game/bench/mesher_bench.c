@@ -0,0 +1,92 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/block_store.h"
+#include "../src/config.h"
+#include "../src/mesher.h"
+#include "../src/world.h"
+
+// A/B of the mesher on generated terrain: per-face against greedy meshing,
+// fresh working buffers per call against a reused scratch, float against
+// packed vertices, and whole chunks against the sections a single block
+// edit at EDIT_Y rebuilds. Reports
+// faces, vertex data, meshing time and page faults per chunk. The world
+// generator is seeded by its noise tables, so every run meshes the same
+// chunks.
+
+#define RADIUS 3
+#define SIDE (RADIUS * 2 + 1)
+#define ROUNDS 5
+#define EDIT_Y 40 // near the surface of most chunks
+
+static BlockStore stores[SIDE][SIDE];
+
+static void _set_func(int x, int y, int z, int w, void *arg) {
+    block_store_set((BlockStore *)arg, x, y, z, w);
+}
+
+static void run(
+    int greedy, int packed, unsigned int sections, MesherScratch *scratch, const char *name)
+{
+    long faces = 0;
+    int meshed = 0;
+    long page_faults = bench_page_faults();
+    double start = bench_now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int a = 1; a < SIDE - 1; a++) {
+            for (int b = 1; b < SIDE - 1; b++) {
+                MesherInput input = {0};
+                input.p = a - RADIUS;
+                input.q = b - RADIUS;
+                input.greedy = greedy;
+                input.packed = packed;
+                input.sections = sections;
+                input.scratch = scratch;
+                for (int da = -1; da <= 1; da++) {
+                    for (int db = -1; db <= 1; db++) {
+                        input.block[da + 1][db + 1] = &stores[a + da][b + db];
+                    }
+                }
+                MesherOutput *output = mesher_compute_chunk(&input);
+                faces += output->faces;
+                mesher_free_output(&output);
+                meshed++;
+            }
+        }
+    }
+    double mesh = (bench_now() - start) * 1000 / meshed;
+    page_faults = bench_page_faults() - page_faults;
+    printf("%-16s %9ld %10.1f KB %9.2f ms %12ld\n",
+        name, faces / meshed, faces / meshed * 4 * MESHER_VERTEX_BYTES(packed) / 1024.0,
+        mesh, page_faults / meshed);
+}
+
+int main(int argc, char **argv) {
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            int p = a - RADIUS;
+            int q = b - RADIUS;
+            block_store_alloc(&stores[a][b], BLOCK_STORE_SECTIONS,
+                p * CHUNK_SIZE - 1, 0, q * CHUNK_SIZE - 1);
+            create_world(p, q, _set_func, &stores[a][b]);
+        }
+    }
+    printf("%-16s %9s %13s %12s %12s\n",
+        "mesher", "faces", "vertices", "mesh", "page faults");
+    unsigned int all = MESHER_ALL_SECTIONS;
+    run(0, 0, all, NULL, "per-face");
+    run(1, 0, all, NULL, "greedy");
+    MesherScratch *scratch = mesher_scratch_create();
+    run(0, 0, all, scratch, "per-face scratch");
+    run(1, 0, all, scratch, "greedy scratch");
+    run(0, 1, all, scratch, "per-face packed");
+    run(1, 1, all, scratch, "greedy packed");
+    run(1, 1, mesher_sections_reading(EDIT_Y, EDIT_Y), scratch, "edit sections");
+    mesher_scratch_destroy(scratch);
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            block_store_free(&stores[a][b]);
+        }
+    }
+    return 0;
+}
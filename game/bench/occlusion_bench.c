@@ -0,0 +1,156 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../deps/noise/noise.h"
+#include "../src/block_store.h"
+#include "../src/config.h"
+#include "../src/item.h"
+#include "../src/mesher.h"
+
+// Meshing time on chunks where ambient occlusion dominates: a dense forest,
+// every exposed leaf and trunk block shaded from above, and stone riddled
+// with caves, lots of faces under a deep roof. The worlds are built from a
+// fixed seed, so every run meshes the same chunks.
+
+#define RADIUS 2
+#define SIDE (RADIUS * 2 + 1)
+#define WIDTH (SIDE * CHUNK_SIZE)
+#define HEIGHT 128
+#define ROUNDS 10
+
+static unsigned char world[WIDTH][HEIGHT][WIDTH];
+static BlockStore stores[SIDE][SIDE];
+
+static void build_forest() {
+    unsigned int state = 1;
+    memset(world, 0, sizeof(world));
+    for (int x = 0; x < WIDTH; x++) {
+        for (int z = 0; z < WIDTH; z++) {
+            for (int y = 0; y < 12; y++) {
+                world[x][y][z] = y < 10 ? STONE : DIRT;
+            }
+            world[x][12][z] = GRASS;
+            if (bench_rand(&state) % 4 == 0) {
+                world[x][13][z] = TALL_GRASS;
+            }
+        }
+    }
+    // a tree on every 4 x 4 cell, trunks 5 to 8 high under a round crown
+    for (int cx = 2; cx < WIDTH - 2; cx += 4) {
+        for (int cz = 2; cz < WIDTH - 2; cz += 4) {
+            int x = cx + (int)(bench_rand(&state) % 3) - 1;
+            int z = cz + (int)(bench_rand(&state) % 3) - 1;
+            int top = 13 + 5 + (int)(bench_rand(&state) % 4);
+            for (int dx = -3; dx <= 3; dx++) {
+                for (int dy = -3; dy <= 3; dy++) {
+                    for (int dz = -3; dz <= 3; dz++) {
+                        int ax = x + dx;
+                        int az = z + dz;
+                        if (ax < 0 || az < 0 || ax >= WIDTH || az >= WIDTH) {
+                            continue;
+                        }
+                        if (dx * dx + dy * dy + dz * dz <= 10 && !world[ax][top + dy][az]) {
+                            world[ax][top + dy][az] = LEAVES;
+                        }
+                    }
+                }
+            }
+            for (int y = 13; y < top; y++) {
+                world[x][y][z] = WOOD;
+            }
+        }
+    }
+}
+
+static void build_caves() {
+    memset(world, 0, sizeof(world));
+    for (int x = 0; x < WIDTH; x++) {
+        for (int z = 0; z < WIDTH; z++) {
+            for (int y = 0; y < 96; y++) {
+                float n = simplex3(x * 0.05, y * 0.08, z * 0.05, 3, 0.5, 2);
+                world[x][y][z] = y > 0 && n > 0.55 ? EMPTY : STONE;
+            }
+            world[x][96][z] = GRASS;
+        }
+    }
+}
+
+static void fill_stores() {
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            int p = a - RADIUS;
+            int q = b - RADIUS;
+            BlockStore *store = &stores[a][b];
+            block_store_alloc(store, BLOCK_STORE_SECTIONS,
+                p * CHUNK_SIZE - 1, 0, q * CHUNK_SIZE - 1);
+            for (int x = 0; x < CHUNK_SIZE; x++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    for (int y = 0; y < HEIGHT; y++) {
+                        int w = world[a * CHUNK_SIZE + x][y][b * CHUNK_SIZE + z];
+                        if (w) {
+                            block_store_set(store,
+                                p * CHUNK_SIZE + x, y, q * CHUNK_SIZE + z, w);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void free_stores() {
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            block_store_free(&stores[a][b]);
+        }
+    }
+}
+
+static void run(const char *name) {
+    MesherScratch *scratch = mesher_scratch_create();
+    long faces = 0;
+    int meshed = 0;
+    double best = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = bench_now();
+        for (int a = 1; a < SIDE - 1; a++) {
+            for (int b = 1; b < SIDE - 1; b++) {
+                MesherInput input = {0};
+                input.p = a - RADIUS;
+                input.q = b - RADIUS;
+                input.greedy = GREEDY_MESHING;
+                input.packed = PACKED_VERTICES;
+                input.sections = MESHER_ALL_SECTIONS;
+                input.scratch = scratch;
+                for (int da = -1; da <= 1; da++) {
+                    for (int db = -1; db <= 1; db++) {
+                        input.block[da + 1][db + 1] = &stores[a + da][b + db];
+                    }
+                }
+                MesherOutput *output = mesher_compute_chunk(&input);
+                faces += output->faces;
+                mesher_free_output(&output);
+                meshed++;
+            }
+        }
+        double elapsed = bench_now() - start;
+        best = round && best < elapsed ? best : elapsed;
+    }
+    int chunks = (SIDE - 2) * (SIDE - 2);
+    printf("%-8s %9ld %9.2f ms\n", name, faces / meshed, best * 1000 / chunks);
+    mesher_scratch_destroy(scratch);
+}
+
+int main(int argc, char **argv) {
+    printf("%-8s %9s %12s\n", "chunks", "faces", "mesh");
+    build_forest();
+    fill_stores();
+    run("forest");
+    free_stores();
+    build_caves();
+    fill_stores();
+    run("caves");
+    free_stores();
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "tinycthread.h"
+#include "../src/block_store.h"
+#include "../src/config.h"
+#include "../src/mesher.h"
+#include "../src/thread_pool.h"
+#include "../src/world.h"
+
+// Chunk throughput of the worker pool: every chunk of a square is generated
+// as one task, then every inner chunk is meshed as one task, the way the
+// chunk manager submits them. Run once per thread count to check scaling.
+
+#define RADIUS 6
+#define SIDE (RADIUS * 2 + 1)
+
+typedef struct {
+    int a;
+    int b;
+    int faces;
+} Job;
+
+static BlockStore stores[SIDE][SIDE];
+static Job jobs[SIDE][SIDE];
+static mtx_t mtx;
+static cnd_t cnd;
+static int remaining;
+
+static void _set_func(int x, int y, int z, int w, void *arg) {
+    block_store_set((BlockStore *)arg, x, y, z, w);
+}
+
+static void _finish() {
+    mtx_lock(&mtx);
+    if (--remaining == 0) {
+        cnd_signal(&cnd);
+    }
+    mtx_unlock(&mtx);
+}
+
+static void _wait() {
+    mtx_lock(&mtx);
+    while (remaining) {
+        cnd_wait(&cnd, &mtx);
+    }
+    mtx_unlock(&mtx);
+}
+
+static void _generate(void *arg) {
+    Job *job = (Job *)arg;
+    int p = job->a - RADIUS;
+    int q = job->b - RADIUS;
+    BlockStore *store = &stores[job->a][job->b];
+    block_store_alloc(store, BLOCK_STORE_SECTIONS,
+        p * CHUNK_SIZE - 1, 0, q * CHUNK_SIZE - 1);
+    create_world(p, q, _set_func, store);
+    _finish();
+}
+
+static void _mesh(void *arg) {
+    Job *job = (Job *)arg;
+    MesherInput input = {0};
+    input.p = job->a - RADIUS;
+    input.q = job->b - RADIUS;
+    input.sections = MESHER_ALL_SECTIONS;
+    for (int da = -1; da <= 1; da++) {
+        for (int db = -1; db <= 1; db++) {
+            input.block[da + 1][db + 1] = &stores[job->a + da][job->b + db];
+        }
+    }
+    MesherOutput *output = mesher_compute_chunk(&input);
+    job->faces = output->faces;
+    mesher_free_output(&output);
+    _finish();
+}
+
+static void run(int threads) {
+    ThreadPool *pool = thread_pool_create(threads);
+    double start = bench_now();
+    remaining = SIDE * SIDE;
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            jobs[a][b].a = a;
+            jobs[a][b].b = b;
+            thread_pool_submit(pool, _generate, &jobs[a][b]);
+        }
+    }
+    _wait();
+    double generate = bench_now() - start;
+
+    start = bench_now();
+    remaining = (SIDE - 2) * (SIDE - 2);
+    for (int a = 1; a < SIDE - 1; a++) {
+        for (int b = 1; b < SIDE - 1; b++) {
+            thread_pool_submit(pool, _mesh, &jobs[a][b]);
+        }
+    }
+    _wait();
+    double mesh = bench_now() - start;
+    thread_pool_destroy(pool);
+
+    long faces = 0;
+    for (int a = 1; a < SIDE - 1; a++) {
+        for (int b = 1; b < SIDE - 1; b++) {
+            faces += jobs[a][b].faces;
+        }
+    }
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            block_store_free(&stores[a][b]);
+        }
+    }
+    printf("%7d %14.1f %14.1f %12ld\n", threads,
+        SIDE * SIDE / generate, (SIDE - 2) * (SIDE - 2) / mesh, faces);
+}
+
+int main(int argc, char **argv) {
+    mtx_init(&mtx, mtx_plain);
+    cnd_init(&cnd);
+    int hardware = thread_pool_hardware_threads();
+    printf("%d hardware threads\n", hardware);
+    printf("%7s %14s %14s %12s\n",
+        "threads", "generated/s", "meshed/s", "faces");
+    for (int threads = 1; threads < hardware; threads *= 2) {
+        run(threads);
+    }
+    run(hardware);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../deps/noise/noise.h"
+#include "../src/block_store.h"
+#include "../src/config.h"
+#include "../src/world.h"
+
+// Terrain generation into both block stores, one callback per block
+// against create_world_columns handing whole vertical runs to
+// block_store_fill. The generator's noise costs far more than either, so
+// the blocks of every chunk are recorded once and replayed into the stores
+// through the same callbacks; "generate" times create_world_columns alone
+// for scale. Both ways must build the same stores. Last, the terrain's
+// noise on its own: simplex2 and simplex3 a point at a time against the
+// batch calls the generator makes, which must give the same values.
+
+#define RADIUS 3
+#define SIDE (RADIUS * 2 + 1)
+#define ROUNDS 5
+#define POINTS 65536
+
+typedef struct {
+    int x, z, y0, y1, w;
+} Run;
+
+typedef struct {
+    int count;
+    int capacity;
+    Run *data;
+} RunList;
+
+static RunList runs[SIDE][SIDE];
+static BlockStore stores[2][SIDE][SIDE];
+
+static void _record_fill_func(int x, int z, int y0, int y1, int w, void *arg) {
+    RunList *list = (RunList *)arg;
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->data = (Run *)realloc(list->data, sizeof(Run) * list->capacity);
+    }
+    Run *run = list->data + list->count++;
+    run->x = x;
+    run->z = z;
+    run->y0 = y0;
+    run->y1 = y1;
+    run->w = w;
+}
+
+static void _record_func(int x, int y, int z, int w, void *arg) {
+    _record_fill_func(x, z, y, y + 1, w, arg);
+}
+
+static void _set_func(int x, int y, int z, int w, void *arg) {
+    block_store_set((BlockStore *)arg, x, y, z, w);
+}
+
+static void _fill_func(int x, int z, int y0, int y1, int w, void *arg) {
+    block_store_fill((BlockStore *)arg, x, z, y0, y1, w);
+}
+
+// the callbacks as create_world sees them, through a pointer
+static world_func set_func = _set_func;
+static world_fill_func fill_func = _fill_func;
+
+static void generate() {
+    double best = 0;
+    long blocks = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        blocks = 0;
+        double start = bench_now();
+        for (int a = 0; a < SIDE; a++) {
+            for (int b = 0; b < SIDE; b++) {
+                RunList *list = &runs[a][b];
+                list->count = 0;
+                create_world_columns(a - RADIUS, b - RADIUS,
+                    _record_func, _record_fill_func, list);
+                for (int i = 0; i < list->count; i++) {
+                    blocks += list->data[i].y1 - list->data[i].y0;
+                }
+            }
+        }
+        double seconds = bench_now() - start;
+        best = round && best < seconds ? best : seconds;
+    }
+    printf("%-18s %10.1f %14.0f %10ld\n", "generate",
+        SIDE * SIDE / best, blocks / best, blocks / (SIDE * SIDE));
+}
+
+static void replay(BlockStoreType type, int columns, const char *name) {
+    double best = 0;
+    long blocks = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        blocks = 0;
+        double seconds = 0;
+        for (int a = 0; a < SIDE; a++) {
+            for (int b = 0; b < SIDE; b++) {
+                BlockStore *store = &stores[columns][a][b];
+                if (round) {
+                    block_store_free(store);
+                }
+                block_store_alloc(store, type,
+                    (a - RADIUS) * CHUNK_SIZE - 1, 0, (b - RADIUS) * CHUNK_SIZE - 1);
+                RunList *list = &runs[a][b];
+                double start = bench_now();
+                for (int i = 0; i < list->count; i++) {
+                    Run *run = list->data + i;
+                    if (columns) {
+                        fill_func(run->x, run->z, run->y0, run->y1, run->w, store);
+                        continue;
+                    }
+                    for (int y = run->y0; y < run->y1; y++) {
+                        set_func(run->x, y, run->z, run->w, store);
+                    }
+                }
+                seconds += bench_now() - start;
+                blocks += block_store_size(store);
+            }
+        }
+        best = round && best < seconds ? best : seconds;
+    }
+    printf("%-18s %10.1f %14.0f %10ld\n", name,
+        SIDE * SIDE / best, blocks / best, blocks / (SIDE * SIDE));
+}
+
+static float inputs[3][POINTS];
+static float outputs[2][POINTS];
+
+static void noise(int dims, int octaves) {
+    unsigned int seed = 777;
+    for (int i = 0; i < POINTS; i++) {
+        for (int d = 0; d < 3; d++) {
+            inputs[d][i] = ((int)(bench_rand(&seed) % 200000) - 100000) * 0.01f;
+        }
+    }
+    double best[2] = {0, 0};
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int batch = 0; batch < 2; batch++) {
+            float *out = outputs[batch];
+            double start = bench_now();
+            if (batch && dims == 2) {
+                simplex2_batch(inputs[0], inputs[1], out, POINTS, octaves, 0.5, 2);
+            }
+            else if (batch) {
+                simplex3_batch(inputs[0], inputs[1], inputs[2], out, POINTS,
+                    octaves, 0.5, 2);
+            }
+            else {
+                for (int i = 0; i < POINTS; i++) {
+                    out[i] = dims == 2 ?
+                        simplex2(inputs[0][i], inputs[1][i], octaves, 0.5, 2) :
+                        simplex3(inputs[0][i], inputs[1][i], inputs[2][i],
+                            octaves, 0.5, 2);
+                }
+            }
+            double seconds = bench_now() - start;
+            best[batch] = round && best[batch] < seconds ? best[batch] : seconds;
+        }
+    }
+    int mismatches = 0;
+    for (int i = 0; i < POINTS; i++) {
+        mismatches += outputs[0][i] != outputs[1][i];
+    }
+    printf("simplex%d %d octaves %12.0f %12.0f %10d\n", dims, octaves,
+        POINTS / best[0], POINTS / best[1], mismatches);
+}
+
+// every block of the per-block stores against the column filled ones
+static int compare() {
+    int mismatches = 0;
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            BlockStore *expected = &stores[0][a][b];
+            BlockStore *actual = &stores[1][a][b];
+            if (block_store_size(expected) != block_store_size(actual)) {
+                mismatches++;
+            }
+            BLOCK_STORE_FOR_EACH(expected, ex, ey, ez, ew) {
+                if (block_store_get(actual, ex, ey, ez) != ew) {
+                    mismatches++;
+                }
+            } END_BLOCK_STORE_FOR_EACH;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char **argv) {
+    printf("%-18s %10s %14s %10s\n", "", "chunks/s", "blocks/s", "blocks");
+    generate();
+    static const BlockStoreType types[] = {BLOCK_STORE_MAP, BLOCK_STORE_SECTIONS};
+    static const char *names[][2] = {
+        {"map per block", "map columns"},
+        {"sections per block", "sections columns"}
+    };
+    for (int t = 0; t < 2; t++) {
+        replay(types[t], 0, names[t][0]);
+        replay(types[t], 1, names[t][1]);
+        int mismatches = compare();
+        if (mismatches) {
+            printf("%d blocks differ between the two ways\n", mismatches);
+        }
+        for (int a = 0; a < SIDE; a++) {
+            for (int b = 0; b < SIDE; b++) {
+                block_store_free(&stores[0][a][b]);
+                block_store_free(&stores[1][a][b]);
+            }
+        }
+    }
+    for (int a = 0; a < SIDE; a++) {
+        for (int b = 0; b < SIDE; b++) {
+            free(runs[a][b].data);
+        }
+    }
+    printf("\n%-18s %12s %12s %10s\n", "points/s", "scalar", "batch", "differ");
+    noise(2, 4);
+    noise(3, 8);
+    return 0;
+}
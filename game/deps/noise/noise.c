@@ -270,3 +270,151 @@ float simplex3(
     }
     return (1 + total / max) / 2;
 }
+
+/*
+Batch versions of simplex2 and simplex3: out[n] is the value for x[n],
+y[n] (and z[n]). Lanes of 4 (SSE2) or 8 (AVX, picked at run time when the
+CPU has it) points are evaluated together and match the scalar functions
+exactly, other CPUs fall back to calling them in a loop.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+    (defined(__i386__) && defined(__SSE2__))
+    #define NOISE_SSE2 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+#if NOISE_SSE2
+
+static __m128 _floor_sse2(__m128 v) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+#define NS_LANES 4
+#define NS_V __m128
+#define NS_TARGET
+#define NS_FN(name) name##_sse2
+#define NS_SET1 _mm_set1_ps
+#define NS_LOAD _mm_loadu_ps
+#define NS_STORE _mm_storeu_ps
+#define NS_ADD _mm_add_ps
+#define NS_SUB _mm_sub_ps
+#define NS_MUL _mm_mul_ps
+#define NS_DIV _mm_div_ps
+#define NS_FLOOR _floor_sse2
+#define NS_GT _mm_cmpgt_ps
+#define NS_AND _mm_and_ps
+#include "noise_simd.h"
+#undef NS_LANES
+#undef NS_V
+#undef NS_TARGET
+#undef NS_FN
+#undef NS_SET1
+#undef NS_LOAD
+#undef NS_STORE
+#undef NS_ADD
+#undef NS_SUB
+#undef NS_MUL
+#undef NS_DIV
+#undef NS_FLOOR
+#undef NS_GT
+#undef NS_AND
+
+#if defined(__GNUC__)
+    #define NOISE_AVX_TARGET __attribute__((target("avx")))
+#else
+    #define NOISE_AVX_TARGET
+#endif
+
+NOISE_AVX_TARGET static __m256 _gt_avx(__m256 a, __m256 b) {
+    return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+}
+
+#define NS_LANES 8
+#define NS_V __m256
+#define NS_TARGET NOISE_AVX_TARGET
+#define NS_FN(name) name##_avx
+#define NS_SET1 _mm256_set1_ps
+#define NS_LOAD _mm256_loadu_ps
+#define NS_STORE _mm256_storeu_ps
+#define NS_ADD _mm256_add_ps
+#define NS_SUB _mm256_sub_ps
+#define NS_MUL _mm256_mul_ps
+#define NS_DIV _mm256_div_ps
+#define NS_FLOOR _mm256_floor_ps
+#define NS_GT _gt_avx
+#define NS_AND _mm256_and_ps
+#include "noise_simd.h"
+
+#if defined(__GNUC__)
+
+// libgcc reads the CPU features before main, with XGETBV for the YMM
+// registers, so any thread may ask without keeping state here
+static int _use_avx() {
+    return __builtin_cpu_supports("avx");
+}
+
+#else
+
+// 0 unknown, 1 SSE2, 2 AVX. Threads racing to set it store the same value;
+// MSVC reads and writes a volatile long atomically.
+static volatile long simd_level = 0;
+
+static int _use_avx() {
+    if (!simd_level) {
+        int avx = 0;
+    #if defined(_MSC_VER)
+        // the OS has to save the YMM registers as well, hence XGETBV
+        int info[4];
+        __cpuid(info, 1);
+        avx = (info[2] & (1 << 28)) && (info[2] & (1 << 27)) &&
+            (_xgetbv(0) & 6) == 6;
+    #endif
+        simd_level = avx ? 2 : 1;
+    }
+    return simd_level == 2;
+}
+
+#endif
+
+#endif
+
+void simplex2_batch(
+    const float *x, const float *y, float *out, int count,
+    int octaves, float persistence, float lacunarity)
+{
+#if NOISE_SSE2
+    if (_use_avx()) {
+        simplex2_batch_avx(x, y, out, count, octaves, persistence, lacunarity);
+    }
+    else {
+        simplex2_batch_sse2(x, y, out, count, octaves, persistence, lacunarity);
+    }
+#else
+    for (int n = 0; n < count; n++) {
+        out[n] = simplex2(x[n], y[n], octaves, persistence, lacunarity);
+    }
+#endif
+}
+
+void simplex3_batch(
+    const float *x, const float *y, const float *z, float *out, int count,
+    int octaves, float persistence, float lacunarity)
+{
+#if NOISE_SSE2
+    if (_use_avx()) {
+        simplex3_batch_avx(x, y, z, out, count, octaves, persistence, lacunarity);
+    }
+    else {
+        simplex3_batch_sse2(x, y, z, out, count, octaves, persistence, lacunarity);
+    }
+#else
+    for (int n = 0; n < count; n++) {
+        out[n] = simplex3(x[n], y[n], z[n], octaves, persistence, lacunarity);
+    }
+#endif
+}
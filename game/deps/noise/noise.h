@@ -37,4 +37,12 @@ float simplex3(
     float x, float y, float z,
     int octaves, float persistence, float lacunarity);
 
+void simplex2_batch(
+    const float *x, const float *y, float *out, int count,
+    int octaves, float persistence, float lacunarity);
+
+void simplex3_batch(
+    const float *x, const float *y, const float *z, float *out, int count,
+    int octaves, float persistence, float lacunarity);
+
 #endif
@@ -0,0 +1,210 @@
+/*
+One vector width of simplex2_batch and simplex3_batch. noise.c includes
+this once per instruction set with these defined:
+
+NS_LANES          floats per vector
+NS_V              the vector type
+NS_TARGET         attribute for the instruction set, if the compiler needs it
+NS_FN(name)       name with the width's suffix
+NS_SET1, NS_LOAD, NS_STORE, NS_ADD, NS_SUB, NS_MUL, NS_DIV, NS_FLOOR
+NS_GT(a, b)       all bits set in the lanes where a > b
+NS_AND(m, v)      v in the lanes set in m, 0 elsewhere
+
+The arithmetic is the scalar noise2 and noise3 step for step, in the same
+order and without fused multiply-adds, so every lane comes out bit for bit
+equal to the scalar call. Only the permutation and gradient lookups stay
+scalar, there is no byte gather to do them with.
+*/
+
+NS_TARGET static NS_V NS_FN(noise2)(NS_V x, NS_V y) {
+    float ia[NS_LANES], ja[NS_LANES], xa[NS_LANES], ya[NS_LANES];
+    float i1a[NS_LANES], j1a[NS_LANES];
+    float gx[3][NS_LANES], gy[3][NS_LANES];
+    NS_V s = NS_MUL(NS_ADD(x, y), NS_SET1(F2));
+    NS_V i = NS_FLOOR(NS_ADD(x, s));
+    NS_V j = NS_FLOOR(NS_ADD(y, s));
+    NS_V t = NS_MUL(NS_ADD(i, j), NS_SET1(G2));
+    NS_V xx[3], yy[3];
+    xx[0] = NS_SUB(x, NS_SUB(i, t));
+    yy[0] = NS_SUB(y, NS_SUB(j, t));
+    NS_STORE(ia, i);
+    NS_STORE(ja, j);
+    NS_STORE(xa, xx[0]);
+    NS_STORE(ya, yy[0]);
+    for (int l = 0; l < NS_LANES; l++) {
+        int i1 = xa[l] > ya[l];
+        int j1 = xa[l] <= ya[l];
+        int I = (int) ia[l] & 255;
+        int J = (int) ja[l] & 255;
+        int g0 = PERM[I + PERM[J]] % 12;
+        int g1 = PERM[I + i1 + PERM[J + j1]] % 12;
+        int g2 = PERM[I + 1 + PERM[J + 1]] % 12;
+        i1a[l] = (float) i1;
+        j1a[l] = (float) j1;
+        gx[0][l] = GRAD3[g0][0];
+        gy[0][l] = GRAD3[g0][1];
+        gx[1][l] = GRAD3[g1][0];
+        gy[1][l] = GRAD3[g1][1];
+        gx[2][l] = GRAD3[g2][0];
+        gy[2][l] = GRAD3[g2][1];
+    }
+    NS_V one = NS_SET1(1.0f);
+    xx[2] = NS_SUB(NS_ADD(xx[0], NS_SET1(G2 * 2.0f)), one);
+    yy[2] = NS_SUB(NS_ADD(yy[0], NS_SET1(G2 * 2.0f)), one);
+    xx[1] = NS_ADD(NS_SUB(xx[0], NS_LOAD(i1a)), NS_SET1(G2));
+    yy[1] = NS_ADD(NS_SUB(yy[0], NS_LOAD(j1a)), NS_SET1(G2));
+    NS_V zero = NS_SET1(0.0f);
+    NS_V noise[3];
+    for (int c = 0; c <= 2; c++) {
+        NS_V f = NS_SUB(NS_SUB(NS_SET1(0.5f),
+            NS_MUL(xx[c], xx[c])), NS_MUL(yy[c], yy[c]));
+        NS_V dot = NS_ADD(
+            NS_MUL(NS_LOAD(gx[c]), xx[c]), NS_MUL(NS_LOAD(gy[c]), yy[c]));
+        noise[c] = NS_AND(NS_GT(f, zero),
+            NS_MUL(NS_MUL(NS_MUL(NS_MUL(f, f), f), f), dot));
+    }
+    return NS_MUL(NS_ADD(NS_ADD(noise[0], noise[1]), noise[2]), NS_SET1(70.0f));
+}
+
+NS_TARGET static NS_V NS_FN(noise3)(NS_V x, NS_V y, NS_V z) {
+    float ia[NS_LANES], ja[NS_LANES], ka[NS_LANES];
+    float pa[3][NS_LANES];
+    float o1a[3][NS_LANES], o2a[3][NS_LANES];
+    float ga[4][3][NS_LANES];
+    NS_V s = NS_MUL(NS_ADD(NS_ADD(x, y), z), NS_SET1(F3));
+    NS_V i = NS_FLOOR(NS_ADD(x, s));
+    NS_V j = NS_FLOOR(NS_ADD(y, s));
+    NS_V k = NS_FLOOR(NS_ADD(z, s));
+    NS_V t = NS_MUL(NS_ADD(NS_ADD(i, j), k), NS_SET1(G3));
+    NS_V pos[4][3];
+    pos[0][0] = NS_SUB(x, NS_SUB(i, t));
+    pos[0][1] = NS_SUB(y, NS_SUB(j, t));
+    pos[0][2] = NS_SUB(z, NS_SUB(k, t));
+    NS_STORE(ia, i);
+    NS_STORE(ja, j);
+    NS_STORE(ka, k);
+    for (int c = 0; c <= 2; c++) {
+        NS_STORE(pa[c], pos[0][c]);
+    }
+    for (int l = 0; l < NS_LANES; l++) {
+        int o1[3], o2[3], g[4];
+        if (pa[0][l] >= pa[1][l]) {
+            if (pa[1][l] >= pa[2][l]) {
+                ASSIGN(o1, 1, 0, 0);
+                ASSIGN(o2, 1, 1, 0);
+            } else if (pa[0][l] >= pa[2][l]) {
+                ASSIGN(o1, 1, 0, 0);
+                ASSIGN(o2, 1, 0, 1);
+            } else {
+                ASSIGN(o1, 0, 0, 1);
+                ASSIGN(o2, 1, 0, 1);
+            }
+        } else {
+            if (pa[1][l] < pa[2][l]) {
+                ASSIGN(o1, 0, 0, 1);
+                ASSIGN(o2, 0, 1, 1);
+            } else if (pa[0][l] < pa[2][l]) {
+                ASSIGN(o1, 0, 1, 0);
+                ASSIGN(o2, 0, 1, 1);
+            } else {
+                ASSIGN(o1, 0, 1, 0);
+                ASSIGN(o2, 1, 1, 0);
+            }
+        }
+        int I = (int) ia[l] & 255;
+        int J = (int) ja[l] & 255;
+        int K = (int) ka[l] & 255;
+        g[0] = PERM[I + PERM[J + PERM[K]]] % 12;
+        g[1] = PERM[I + o1[0] + PERM[J + o1[1] + PERM[o1[2] + K]]] % 12;
+        g[2] = PERM[I + o2[0] + PERM[J + o2[1] + PERM[o2[2] + K]]] % 12;
+        g[3] = PERM[I + 1 + PERM[J + 1 + PERM[K + 1]]] % 12;
+        for (int c = 0; c <= 2; c++) {
+            o1a[c][l] = (float) o1[c];
+            o2a[c][l] = (float) o2[c];
+            for (int n = 0; n <= 3; n++) {
+                ga[n][c][l] = GRAD3[g[n]][c];
+            }
+        }
+    }
+    for (int c = 0; c <= 2; c++) {
+        pos[3][c] = NS_ADD(NS_SUB(pos[0][c], NS_SET1(1.0f)), NS_SET1(3.0f * G3));
+        pos[2][c] = NS_ADD(NS_SUB(pos[0][c], NS_LOAD(o2a[c])), NS_SET1(2.0f * G3));
+        pos[1][c] = NS_ADD(NS_SUB(pos[0][c], NS_LOAD(o1a[c])), NS_SET1(G3));
+    }
+    NS_V zero = NS_SET1(0.0f);
+    NS_V noise[4];
+    for (int c = 0; c <= 3; c++) {
+        NS_V f = NS_SUB(NS_SUB(NS_SUB(NS_SET1(0.6f),
+            NS_MUL(pos[c][0], pos[c][0])), NS_MUL(pos[c][1], pos[c][1])),
+            NS_MUL(pos[c][2], pos[c][2]));
+        NS_V dot = NS_ADD(NS_ADD(
+            NS_MUL(pos[c][0], NS_LOAD(ga[c][0])),
+            NS_MUL(pos[c][1], NS_LOAD(ga[c][1]))),
+            NS_MUL(pos[c][2], NS_LOAD(ga[c][2])));
+        noise[c] = NS_AND(NS_GT(f, zero),
+            NS_MUL(NS_MUL(NS_MUL(NS_MUL(f, f), f), f), dot));
+    }
+    return NS_MUL(NS_ADD(NS_ADD(NS_ADD(noise[0], noise[1]), noise[2]), noise[3]),
+        NS_SET1(32.0f));
+}
+
+NS_TARGET static void NS_FN(simplex2_batch)(
+    const float *x, const float *y, float *out, int count,
+    int octaves, float persistence, float lacunarity)
+{
+    for (int n = 0; n < count; n += NS_LANES) {
+        int lanes = count - n < NS_LANES ? count - n : NS_LANES;
+        float xb[NS_LANES] = {0}, yb[NS_LANES] = {0}, result[NS_LANES];
+        memcpy(xb, x + n, sizeof(float) * lanes);
+        memcpy(yb, y + n, sizeof(float) * lanes);
+        NS_V vx = NS_LOAD(xb);
+        NS_V vy = NS_LOAD(yb);
+        float freq = 1.0f;
+        float amp = 1.0f;
+        float max = 1.0f;
+        NS_V total = NS_FN(noise2)(vx, vy);
+        for (int i = 1; i < octaves; i++) {
+            freq *= lacunarity;
+            amp *= persistence;
+            max += amp;
+            NS_V noise = NS_FN(noise2)(
+                NS_MUL(vx, NS_SET1(freq)), NS_MUL(vy, NS_SET1(freq)));
+            total = NS_ADD(total, NS_MUL(noise, NS_SET1(amp)));
+        }
+        NS_STORE(result, NS_DIV(
+            NS_ADD(NS_SET1(1.0f), NS_DIV(total, NS_SET1(max))), NS_SET1(2.0f)));
+        memcpy(out + n, result, sizeof(float) * lanes);
+    }
+}
+
+NS_TARGET static void NS_FN(simplex3_batch)(
+    const float *x, const float *y, const float *z, float *out, int count,
+    int octaves, float persistence, float lacunarity)
+{
+    for (int n = 0; n < count; n += NS_LANES) {
+        int lanes = count - n < NS_LANES ? count - n : NS_LANES;
+        float xb[NS_LANES] = {0}, yb[NS_LANES] = {0}, zb[NS_LANES] = {0};
+        float result[NS_LANES];
+        memcpy(xb, x + n, sizeof(float) * lanes);
+        memcpy(yb, y + n, sizeof(float) * lanes);
+        memcpy(zb, z + n, sizeof(float) * lanes);
+        NS_V vx = NS_LOAD(xb);
+        NS_V vy = NS_LOAD(yb);
+        NS_V vz = NS_LOAD(zb);
+        float freq = 1.0f;
+        float amp = 1.0f;
+        float max = 1.0f;
+        NS_V total = NS_FN(noise3)(vx, vy, vz);
+        for (int i = 1; i < octaves; i++) {
+            freq *= lacunarity;
+            amp *= persistence;
+            max += amp;
+            NS_V f = NS_SET1(freq);
+            NS_V noise = NS_FN(noise3)(NS_MUL(vx, f), NS_MUL(vy, f), NS_MUL(vz, f));
+            total = NS_ADD(total, NS_MUL(noise, NS_SET1(amp)));
+        }
+        NS_STORE(result, NS_DIV(
+            NS_ADD(NS_SET1(1.0f), NS_DIV(total, NS_SET1(max))), NS_SET1(2.0f)));
+        memcpy(out + n, result, sizeof(float) * lanes);
+    }
+}
@@ -16,7 +16,14 @@ varying float diffuse;
 const float pi = 3.14159265;
 
 void main() {
-    vec3 color = vec3(texture2D(sampler, fragment_uv));
+    vec2 uv = fragment_uv;
+    if (uv.x >= 2.0) {
+        // merged face from make_cube_face_span, repeat the tile per block
+        uv -= 2.0;
+        vec2 tile = floor(uv / 512.0);
+        uv = (tile + 1.0 / 128.0 + fract(uv) * (1.0 - 1.0 / 64.0)) / 16.0;
+    }
+    vec3 color = vec3(texture2D(sampler, uv));
     if (color == vec3(1.0, 0.0, 1.0)) {
         discard;
     }
@@ -4,8 +4,10 @@ uniform mat4 matrix;
 uniform vec3 camera;
 uniform float fog_distance;
 uniform int ortho;
+uniform int packed_vertices;
+uniform vec3 origin;
 
-attribute vec4 position;
+attribute vec4 position; // the four shorts of cube.h when packed
 attribute vec3 normal;
 attribute vec4 uv;
 
@@ -19,21 +21,78 @@ varying float diffuse;
 const float pi = 3.14159265;
 const vec3 light_direction = normalize(vec3(-1.0, 1.0, -1.0));
 
+// per face of make_cube: normal, and the axes the tile runs along, a
+// negative axis starts 256 blocks up so the uv never goes below zero
+const vec3 normals[6] = vec3[6](
+    vec3(-1.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+    vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0));
+const vec3 u_axes[6] = vec3[6](
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0), vec3(1.0, 0.0, 0.0),
+    vec3(1.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0));
+const vec3 v_axes[6] = vec3[6](
+    vec3(0.0, 1.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, -1.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 1.0, 0.0));
+
 void main() {
-    gl_Position = matrix * position;
-    fragment_uv = uv.xy;
-    fragment_ao = 0.3 + (1.0 - uv.z) * 0.7;
-    fragment_light = uv.w;
-    diffuse = max(0.0, dot(normal, light_direction));
+    vec4 world = position;
+    vec3 world_normal = normal;
+    if (bool(packed_vertices)) {
+        float x = mod(position.x, 64.0);
+        float z = mod(floor(position.x / 64.0), 64.0);
+        float kind = floor(position.x / 4096.0);
+        float y = mod(position.y, 512.0);
+        float u = mod(floor(position.y / 512.0), 2.0);
+        float v = mod(floor(position.y / 1024.0), 2.0);
+        float h = floor(position.y / 2048.0);
+        float tile = mod(position.z, 256.0);
+        float ao = floor(position.z / 256.0) / 32.0;
+        float light = mod(position.w, 64.0) / 60.0;
+        float turn = floor(position.w / 64.0) / 256.0 * 2.0 * pi;
+        vec2 tile_uv = vec2(mod(tile, 16.0), floor(tile / 16.0));
+        if (kind >= 8.0) {
+            // plant, a quad through the block center turned around y
+            int face = int(kind - 8.0);
+            vec3 corner = face < 2 ?
+                vec3(0.0, v - 0.5, h - 0.5) : vec3(h - 0.5, v - 0.5, 0.0);
+            mat3 rotation = mat3(
+                cos(turn), 0.0, sin(turn),
+                0.0, 1.0, 0.0,
+                -sin(turn), 0.0, cos(turn));
+            world = vec4(origin + vec3(x, y, z) + rotation * corner, 1.0);
+            world_normal = rotation * normals[face];
+            fragment_uv = (tile_uv + vec2(u, v)) / 16.0;
+        }
+        else {
+            // cube corner, the tile repeats per block like make_cube_face_span
+            int face = int(kind);
+            vec3 corner = vec3(x, y, z);
+            world = vec4(origin + corner - 0.5, 1.0);
+            world_normal = normals[face];
+            vec2 blocks = vec2(dot(u_axes[face], corner), dot(v_axes[face], corner));
+            blocks += 256.0 * vec2(
+                step(dot(u_axes[face], vec3(1.0)), 0.0),
+                step(dot(v_axes[face], vec3(1.0)), 0.0));
+            fragment_uv = 2.0 + tile_uv * 512.0 + blocks;
+        }
+        fragment_ao = 0.3 + (1.0 - ao) * 0.7;
+        fragment_light = light;
+    }
+    else {
+        fragment_uv = uv.xy;
+        fragment_ao = 0.3 + (1.0 - uv.z) * 0.7;
+        fragment_light = uv.w;
+    }
+    gl_Position = matrix * world;
+    diffuse = max(0.0, dot(world_normal, light_direction));
     if (bool(ortho)) {
         fog_factor = 0.0;
         fog_height = 0.0;
     }
     else {
-        float camera_distance = distance(camera, vec3(position));
+        float camera_distance = distance(camera, vec3(world));
         fog_factor = pow(clamp(camera_distance / fog_distance, 0.0, 1.0), 4.0);
-        float dy = position.y - camera.y;
-        float dx = distance(position.xz, camera.xz);
+        float dy = world.y - camera.y;
+        float dx = distance(world.xz, camera.xz);
         fog_height = (atan(dy, dx) + pi / 2) / pi;
     }
 }
@@ -0,0 +1,170 @@
+#include "block_store.h"
+
+#define BLOCK_STORE_MAP_MASK 0xff // grown to fit, or sized up front by block_store_reserve
+
+void block_store_alloc(BlockStore *store, BlockStoreType type, int dx, int dy, int dz) {
+    store->type = type;
+    if (type == BLOCK_STORE_SECTIONS) {
+        section_store_alloc(&store->sections, dx, dy, dz);
+    }
+    else {
+        map_alloc(&store->map, dx, dy, dz, BLOCK_STORE_MAP_MASK);
+    }
+}
+
+void block_store_free(BlockStore *store) {
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        section_store_free(&store->sections);
+    }
+    else {
+        map_free(&store->map);
+    }
+}
+
+void block_store_copy(BlockStore *dst, BlockStore *src) {
+    dst->type = src->type;
+    if (src->type == BLOCK_STORE_SECTIONS) {
+        section_store_copy(&dst->sections, &src->sections);
+    }
+    else {
+        map_copy(&dst->map, &src->map);
+    }
+}
+
+// cheap read-only snapshot, writers on either side copy on write
+void block_store_share(BlockStore *dst, BlockStore *src) {
+    dst->type = src->type;
+    if (src->type == BLOCK_STORE_SECTIONS) {
+        section_store_share(&dst->sections, &src->sections);
+    }
+    else {
+        map_share(&dst->map, &src->map);
+    }
+}
+
+int block_store_set(BlockStore *store, int x, int y, int z, int w) {
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        return section_store_set(&store->sections, x, y, z, w);
+    }
+    return map_set(&store->map, x, y, z, w);
+}
+
+// sets y0 <= y < y1 of the column at x, z to w
+int block_store_fill(BlockStore *store, int x, int z, int y0, int y1, int w) {
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        return section_store_fill(&store->sections, x, z, y0, y1, w);
+    }
+    int changed = 0;
+    for (int y = y0; y < y1; y++) {
+        changed |= map_set(&store->map, x, y, z, w);
+    }
+    return changed;
+}
+
+int block_store_get(BlockStore *store, int x, int y, int z) {
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        return section_store_get(&store->sections, x, y, z);
+    }
+    return map_get(&store->map, x, y, z);
+}
+
+size_t block_store_memory_usage(BlockStore *store) {
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        return section_store_memory_usage(&store->sections);
+    }
+    size_t slots = store->map.mask + 1;
+    if (store->map.old_data) {
+        slots += store->map.old_mask + 1;
+    }
+    return sizeof(Map) + slots * sizeof(MapEntry);
+}
+
+unsigned int block_store_size(BlockStore *store) {
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        return store->sections.size;
+    }
+    return store->map.size;
+}
+
+// presizes the map for count blocks, sections are allocated as they fill
+void block_store_reserve(BlockStore *store, unsigned int count) {
+    if (store->type == BLOCK_STORE_MAP) {
+        map_reserve(&store->map, count);
+    }
+}
+
+// includes light maps, they are Maps as well
+unsigned long long block_store_copied_bytes() {
+    return map_copied_bytes() + section_store_copied_bytes();
+}
+
+BlockStoreIterator block_store_iterator_begin(BlockStore *store) {
+    BlockStoreIterator iterator;
+    iterator.store = store;
+    iterator.section = 0;
+    iterator.end_section = SECTION_COUNT;
+    iterator.index = 0;
+    return iterator;
+}
+BlockStoreIterator block_store_iterator_range(BlockStore *store, int miny, int maxy) {
+    BlockStoreIterator iterator = block_store_iterator_begin(store);
+    if (store->type == BLOCK_STORE_SECTIONS) {
+        miny -= store->sections.dy;
+        maxy -= store->sections.dy;
+        if (miny > maxy || maxy < 0 || miny >= SECTION_COUNT * SECTION_HEIGHT) {
+            iterator.end_section = 0;
+            return iterator;
+        }
+        iterator.section = miny > 0 ? miny / SECTION_HEIGHT : 0;
+        if (maxy / SECTION_HEIGHT + 1 < SECTION_COUNT) {
+            iterator.end_section = maxy / SECTION_HEIGHT + 1;
+        }
+    }
+    return iterator;
+}
+
+int block_store_iterator_next(
+    BlockStoreIterator *iterator, int *x, int *y, int *z, int *w)
+{
+    BlockStore *store = iterator->store;
+    if (store->type == BLOCK_STORE_MAP) {
+        Map *map = &store->map;
+        unsigned int end = map->mask + 1 + (map->old_data ? map->old_mask + 1 : 0);
+        while (iterator->index < end) {
+            // the old table of a resize under way follows the new one
+            unsigned int index = iterator->index++;
+            MapEntry *entry = index <= map->mask ?
+                map->data + index : map->old_data + (index - map->mask - 1);
+            if (EMPTY_ENTRY(entry)) {
+                continue;
+            }
+            *x = entry->e.x + map->dx;
+            *y = entry->e.y + map->dy;
+            *z = entry->e.z + map->dz;
+            *w = entry->e.w;
+            return 1;
+        }
+        return 0;
+    }
+    SectionStore *sections = &store->sections;
+    while (iterator->section < iterator->end_section) {
+        Section *section = sections->sections[iterator->section];
+        while (section && iterator->index < SECTION_VOLUME) {
+            unsigned int index = iterator->index++;
+            int value = section_get_cell(section, index);
+            if (!value) {
+                continue;
+            }
+            unsigned int column = index / SECTION_HEIGHT;
+            *x = column / SECTION_SIDE + sections->dx;
+            *y = iterator->section * SECTION_HEIGHT +
+                index % SECTION_HEIGHT + sections->dy;
+            *z = column % SECTION_SIDE + sections->dz;
+            *w = value;
+            return 1;
+        }
+        iterator->section++;
+        iterator->index = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef _block_store_h_
+#define _block_store_h_
+
+#include <stddef.h>
+#include "map.h"
+#include "section_store.h"
+
+// Block storage interface for chunks. Both backends hold the same
+// (x, y, z) -> w data, so callers can switch between them to compare memory
+// and frame time without caring which one is active.
+
+typedef enum {
+    BLOCK_STORE_MAP, // open-addressing hash map (map.c)
+    BLOCK_STORE_SECTIONS // paletted vertical sections (section_store.c)
+} BlockStoreType;
+
+typedef struct {
+    BlockStoreType type;
+    Map map;
+    SectionStore sections;
+} BlockStore;
+
+typedef struct {
+    BlockStore *store;
+    unsigned int section;
+    unsigned int end_section;
+    unsigned int index;
+} BlockStoreIterator;
+
+#define BLOCK_STORE_FOR_EACH(store, ex, ey, ez, ew) { \
+    BlockStoreIterator _iterator = block_store_iterator_begin(store); \
+    int ex, ey, ez, ew; \
+    while (block_store_iterator_next(&_iterator, &ex, &ey, &ez, &ew)) {
+
+// visits the blocks from miny to maxy and maybe others, the sections store
+// skips its sections outside the range, the map visits every block
+#define BLOCK_STORE_FOR_EACH_IN_RANGE(store, miny, maxy, ex, ey, ez, ew) { \
+    BlockStoreIterator _iterator = block_store_iterator_range(store, miny, maxy); \
+    int ex, ey, ez, ew; \
+    while (block_store_iterator_next(&_iterator, &ex, &ey, &ez, &ew)) {
+
+#define END_BLOCK_STORE_FOR_EACH } }
+
+void block_store_alloc(BlockStore *store, BlockStoreType type, int dx, int dy, int dz);
+void block_store_free(BlockStore *store);
+void block_store_copy(BlockStore *dst, BlockStore *src);
+void block_store_share(BlockStore *dst, BlockStore *src);
+int block_store_set(BlockStore *store, int x, int y, int z, int w);
+int block_store_fill(BlockStore *store, int x, int z, int y0, int y1, int w);
+int block_store_get(BlockStore *store, int x, int y, int z);
+size_t block_store_memory_usage(BlockStore *store);
+unsigned int block_store_size(BlockStore *store);
+void block_store_reserve(BlockStore *store, unsigned int count);
+unsigned long long block_store_copied_bytes();
+
+BlockStoreIterator block_store_iterator_begin(BlockStore *store);
+BlockStoreIterator block_store_iterator_range(BlockStore *store, int miny, int maxy);
+int block_store_iterator_next(
+    BlockStoreIterator *iterator, int *x, int *y, int *z, int *w);
+
+#endif
@@ -2,16 +2,31 @@
 #define _chunk_h_
 
 #include "map.h"
+#include "block_store.h"
 #include "sign.h"
 #include <stdint.h>
 #include "renderer.h"
 
+// a block or light source set before the chunk was loaded
 typedef struct {
-    Map map; // (x, y, z) -> block type
-    Map lights; // (x, y, z) -> light level
+    int x, y, z, w;
+    int light;
+} ChunkEdit;
+
+typedef struct {
+    BlockStore blocks; // (x, y, z) -> block type
+    Map lights; // (x, y, z) -> light level of the source there
+    Map light_levels; // (x, y, z) -> light reaching the block, see lighting.h
     SignList signs;
+    int signs_dirty; // signs changed since the last sign mesh
     int p, q; // acts as address of the chunk
     int dirty; // for optimization in mesh rebuilding if 1
+    unsigned int dirty_sections; // mesh sections to rebuild, see mesher.h
+    int busy; // version the chunk's worker job in flight was handed, 0 if none
+    int loaded; // terrain and saved blocks are in, false while being generated
+    ChunkEdit *edits; // set again on the loaded stores, see _replay_edits
+    int edit_count, edit_capacity;
+    int version; // bumped when a mesh in flight becomes out of date
     int miny, maxy;
     RenderableObjectID render_id;
 } Chunk;
@@ -0,0 +1,294 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chunk_cache.h"
+#include "config.h"
+
+#define NO_SLOT (-1)
+
+typedef struct {
+    size_t size;
+    size_t capacity;
+    unsigned char *data;
+} ByteBuffer;
+
+typedef struct {
+    int count;
+    int capacity;
+    uint32_t *data; // position << 8 | block, positions are unique
+} CellList;
+
+// INTERNAL HELPERS //
+static void _unlink(ChunkCache *cache, int slot);
+static void _link_front(ChunkCache *cache, int slot);
+static void _remove_slot(ChunkCache *cache, int slot);
+static void _cell_list_add(CellList *cells, int ox, int oz, int x, int y, int z, int w);
+static void _encode_cells(ByteBuffer *buffer, CellList *cells);
+static void _decode_cells(
+    const unsigned char *data, size_t size, int ox, int oz, BlockStore *blocks, Map *lights);
+static int _compare_cells(const void *a, const void *b);
+static void _write_byte(ByteBuffer *buffer, unsigned char value);
+static void _write_varint(ByteBuffer *buffer, uint32_t value);
+static uint32_t _read_varint(const unsigned char **data);
+// ========
+
+void chunk_cache_alloc(ChunkCache *cache, size_t capacity) {
+    cache->capacity = capacity;
+    cache->memory = 0;
+    cache->count = 0;
+    cache->slot_count = 0;
+    cache->slot_capacity = 64;
+    cache->free_slot = NO_SLOT;
+    cache->head = NO_SLOT;
+    cache->tail = NO_SLOT;
+    cache->entries = (ChunkCacheEntry *)malloc(
+        sizeof(ChunkCacheEntry) * cache->slot_capacity);
+    chunk_index_alloc(&cache->index, 0xff);
+    cache->hits = 0;
+    cache->misses = 0;
+}
+
+void chunk_cache_free(ChunkCache *cache) {
+    chunk_cache_clear(cache);
+    free(cache->entries);
+    cache->entries = NULL;
+    chunk_index_free(&cache->index);
+}
+
+void chunk_cache_clear(ChunkCache *cache) {
+    while (cache->tail != NO_SLOT) {
+        _remove_slot(cache, cache->tail);
+    }
+}
+
+// evicts the least recently used entries until the new one fits, an entry
+// bigger than the whole cache is not kept
+void chunk_cache_put(ChunkCache *cache, ChunkCacheData *data) {
+    chunk_cache_remove(cache, data->p, data->q);
+    if (data->size > cache->capacity) {
+        chunk_cache_data_free(&data);
+        return;
+    }
+    while (cache->memory + data->size > cache->capacity) {
+        _remove_slot(cache, cache->tail);
+    }
+    int slot = cache->free_slot;
+    if (slot != NO_SLOT) {
+        cache->free_slot = cache->entries[slot].next;
+    }
+    else {
+        if (cache->slot_count == cache->slot_capacity) {
+            cache->slot_capacity *= 2;
+            cache->entries = (ChunkCacheEntry *)realloc(cache->entries,
+                sizeof(ChunkCacheEntry) * cache->slot_capacity);
+        }
+        slot = cache->slot_count++;
+    }
+    cache->entries[slot].data = *data;
+    free(data);
+    _link_front(cache, slot);
+    chunk_index_set(&cache->index, cache->entries[slot].data.p,
+        cache->entries[slot].data.q, slot);
+    cache->memory += cache->entries[slot].data.size;
+    cache->count++;
+}
+
+ChunkCacheData *chunk_cache_take(ChunkCache *cache, int p, int q) {
+    int slot = chunk_index_get(&cache->index, p, q);
+    if (slot == CHUNK_INDEX_NONE) {
+        cache->misses++;
+        return NULL;
+    }
+    cache->hits++;
+    ChunkCacheData *data = (ChunkCacheData *)malloc(sizeof(ChunkCacheData));
+    *data = cache->entries[slot].data;
+    cache->entries[slot].data.data = NULL; // now owned by the caller
+    _remove_slot(cache, slot);
+    return data;
+}
+
+void chunk_cache_remove(ChunkCache *cache, int p, int q) {
+    int slot = chunk_index_get(&cache->index, p, q);
+    if (slot != CHUNK_INDEX_NONE) {
+        _remove_slot(cache, slot);
+    }
+}
+
+ChunkCacheData *chunk_cache_encode(int p, int q, BlockStore *blocks, Map *lights) {
+    int ox = p * CHUNK_SIZE - 1;
+    int oz = q * CHUNK_SIZE - 1;
+    CellList cells = {0, 0, NULL};
+    ByteBuffer buffer = {0, 0, NULL};
+    BLOCK_STORE_FOR_EACH(blocks, ex, ey, ez, ew) {
+        _cell_list_add(&cells, ox, oz, ex, ey, ez, ew);
+    } END_BLOCK_STORE_FOR_EACH;
+    _encode_cells(&buffer, &cells);
+    size_t blocks_size = buffer.size;
+    cells.count = 0;
+    MAP_FOR_EACH(lights, ex, ey, ez, ew) {
+        _cell_list_add(&cells, ox, oz, ex, ey, ez, ew);
+    } END_MAP_FOR_EACH;
+    _encode_cells(&buffer, &cells);
+    free(cells.data);
+
+    ChunkCacheData *data = (ChunkCacheData *)malloc(sizeof(ChunkCacheData));
+    data->p = p;
+    data->q = q;
+    data->blocks_size = blocks_size;
+    data->size = buffer.size;
+    data->data = (unsigned char *)realloc(buffer.data, buffer.size ? buffer.size : 1);
+    return data;
+}
+
+// blocks and lights must be freshly allocated for the chunk
+void chunk_cache_decode(const ChunkCacheData *data, BlockStore *blocks, Map *lights) {
+    int ox = data->p * CHUNK_SIZE - 1;
+    int oz = data->q * CHUNK_SIZE - 1;
+    _decode_cells(data->data, data->blocks_size, ox, oz, blocks, NULL);
+    _decode_cells(data->data + data->blocks_size, data->size - data->blocks_size,
+        ox, oz, NULL, lights);
+}
+
+void chunk_cache_data_free(ChunkCacheData **data) {
+    if (data && *data) {
+        free((*data)->data);
+        free(*data);
+        *data = NULL;
+    }
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+
+static void _unlink(ChunkCache *cache, int slot) {
+    ChunkCacheEntry *entry = cache->entries + slot;
+    if (entry->prev != NO_SLOT) {
+        cache->entries[entry->prev].next = entry->next;
+    }
+    else {
+        cache->head = entry->next;
+    }
+    if (entry->next != NO_SLOT) {
+        cache->entries[entry->next].prev = entry->prev;
+    }
+    else {
+        cache->tail = entry->prev;
+    }
+}
+
+static void _link_front(ChunkCache *cache, int slot) {
+    ChunkCacheEntry *entry = cache->entries + slot;
+    entry->prev = NO_SLOT;
+    entry->next = cache->head;
+    if (cache->head != NO_SLOT) {
+        cache->entries[cache->head].prev = slot;
+    }
+    else {
+        cache->tail = slot;
+    }
+    cache->head = slot;
+}
+
+static void _remove_slot(ChunkCache *cache, int slot) {
+    ChunkCacheEntry *entry = cache->entries + slot;
+    _unlink(cache, slot);
+    chunk_index_remove(&cache->index, entry->data.p, entry->data.q);
+    cache->memory -= entry->data.size;
+    cache->count--;
+    free(entry->data.data);
+    entry->data.data = NULL;
+    entry->next = cache->free_slot;
+    cache->free_slot = slot;
+}
+
+static void _cell_list_add(CellList *cells, int ox, int oz, int x, int y, int z, int w) {
+    if (cells->count == cells->capacity) {
+        cells->capacity = cells->capacity ? cells->capacity * 2 : 4096;
+        cells->data = (uint32_t *)realloc(cells->data, sizeof(uint32_t) * cells->capacity);
+    }
+    // column by column, so a run follows y up a column and on into the next
+    uint32_t position = ((uint32_t)(x - ox) & 0xff) << 16 |
+        ((uint32_t)(z - oz) & 0xff) << 8 | ((uint32_t)y & 0xff);
+    cells->data[cells->count++] = position << 8 | (unsigned char)w;
+}
+
+// runs of consecutive positions holding the same value, each written as the
+// gap since the previous run, the run length and the value
+static void _encode_cells(ByteBuffer *buffer, CellList *cells) {
+    qsort(cells->data, cells->count, sizeof(uint32_t), _compare_cells);
+    uint32_t end = 0;
+    int i = 0;
+    while (i < cells->count) {
+        uint32_t start = cells->data[i] >> 8;
+        unsigned char value = cells->data[i] & 0xff;
+        int length = 1;
+        while (i + length < cells->count &&
+            cells->data[i + length] >> 8 == start + length &&
+            (cells->data[i + length] & 0xff) == value)
+        {
+            length++;
+        }
+        _write_varint(buffer, start - end);
+        _write_varint(buffer, length);
+        _write_byte(buffer, value);
+        end = start + length;
+        i += length;
+    }
+}
+
+static void _decode_cells(
+    const unsigned char *data, size_t size, int ox, int oz, BlockStore *blocks, Map *lights)
+{
+    const unsigned char *stop = data + size;
+    uint32_t end = 0;
+    while (data < stop) {
+        uint32_t start = end + _read_varint(&data);
+        uint32_t length = _read_varint(&data);
+        int w = (signed char)*data++;
+        for (uint32_t position = start; position < start + length; position++) {
+            int x = ox + (int)(position >> 16);
+            int z = oz + (int)((position >> 8) & 0xff);
+            int y = (int)(position & 0xff);
+            if (blocks) {
+                block_store_set(blocks, x, y, z, w);
+            }
+            else {
+                map_set(lights, x, y, z, w);
+            }
+        }
+        end = start + length;
+    }
+}
+
+static int _compare_cells(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void _write_byte(ByteBuffer *buffer, unsigned char value) {
+    if (buffer->size == buffer->capacity) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        buffer->data = (unsigned char *)realloc(buffer->data, buffer->capacity);
+    }
+    buffer->data[buffer->size++] = value;
+}
+
+static void _write_varint(ByteBuffer *buffer, uint32_t value) {
+    while (value >= 0x80) {
+        _write_byte(buffer, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    _write_byte(buffer, (unsigned char)value);
+}
+
+static uint32_t _read_varint(const unsigned char **data) {
+    uint32_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = *(*data)++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
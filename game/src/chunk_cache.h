@@ -0,0 +1,56 @@
+#ifndef _chunk_cache_h_
+#define _chunk_cache_h_
+
+#include <stddef.h>
+#include "block_store.h"
+#include "chunk_index.h"
+#include "map.h"
+
+// Size-bounded LRU of evicted chunks, so walking back into an area is a
+// decode instead of terrain generation plus database reads. Blocks and
+// lights are sorted column by column and stored as runs of equal values
+// with delta-coded positions, which squeezes air and stone columns down to
+// a few bytes each.
+
+typedef struct {
+    int p;
+    int q;
+    size_t blocks_size; // block runs come first, light runs after them
+    size_t size;
+    unsigned char *data;
+} ChunkCacheData;
+
+typedef struct {
+    ChunkCacheData data;
+    int prev; // towards the most recently used entry
+    int next;
+} ChunkCacheEntry;
+
+typedef struct {
+    size_t capacity; // bytes of encoded data kept at most
+    size_t memory;
+    int count;
+    int slot_count;
+    int slot_capacity;
+    int free_slot;
+    int head; // most recently used
+    int tail;
+    ChunkCacheEntry *entries;
+    ChunkIndex index; // (p, q) -> slot in entries
+    unsigned int hits;
+    unsigned int misses;
+} ChunkCache;
+
+void chunk_cache_alloc(ChunkCache *cache, size_t capacity);
+void chunk_cache_free(ChunkCache *cache);
+void chunk_cache_clear(ChunkCache *cache);
+void chunk_cache_put(ChunkCache *cache, ChunkCacheData *data); // takes the data
+ChunkCacheData *chunk_cache_take(ChunkCache *cache, int p, int q); // NULL on a miss
+void chunk_cache_remove(ChunkCache *cache, int p, int q);
+
+// pure functions, safe to call from worker threads
+ChunkCacheData *chunk_cache_encode(int p, int q, BlockStore *blocks, Map *lights);
+void chunk_cache_decode(const ChunkCacheData *data, BlockStore *blocks, Map *lights);
+void chunk_cache_data_free(ChunkCacheData **data);
+
+#endif
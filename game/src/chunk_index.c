@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include "chunk_index.h"
+
+#define EMPTY_SLOT(entry) ((entry)->value == CHUNK_INDEX_NONE)
+
+// INTERNAL HELPERS //
+static unsigned int _hash(int p, int q);
+static void _clear_entries(ChunkIndexEntry *data, unsigned int count);
+// ========
+
+void chunk_index_alloc(ChunkIndex *index, int mask) {
+    index->mask = mask;
+    index->size = 0;
+    index->data = (ChunkIndexEntry *)malloc(
+        (index->mask + 1) * sizeof(ChunkIndexEntry));
+    _clear_entries(index->data, index->mask + 1);
+}
+
+void chunk_index_free(ChunkIndex *index) {
+    free(index->data);
+    index->data = NULL;
+    index->size = 0;
+}
+
+void chunk_index_clear(ChunkIndex *index) {
+    _clear_entries(index->data, index->mask + 1);
+    index->size = 0;
+}
+
+void chunk_index_grow(ChunkIndex *index) {
+    ChunkIndex new_index;
+    chunk_index_alloc(&new_index, (index->mask << 1) | 1);
+    for (unsigned int i = 0; i <= index->mask; i++) {
+        ChunkIndexEntry *entry = index->data + i;
+        if (!EMPTY_SLOT(entry)) {
+            chunk_index_set(&new_index, entry->p, entry->q, entry->value);
+        }
+    }
+    free(index->data);
+    index->mask = new_index.mask;
+    index->size = new_index.size;
+    index->data = new_index.data;
+}
+
+void chunk_index_set(ChunkIndex *index, int p, int q, int value) {
+    if (value == CHUNK_INDEX_NONE) {
+        chunk_index_remove(index, p, q);
+        return;
+    }
+    unsigned int i = _hash(p, q) & index->mask;
+    ChunkIndexEntry *entry = index->data + i;
+    while (!EMPTY_SLOT(entry)) {
+        if (entry->p == p && entry->q == q) {
+            entry->value = value;
+            return;
+        }
+        i = (i + 1) & index->mask;
+        entry = index->data + i;
+    }
+    entry->p = p;
+    entry->q = q;
+    entry->value = value;
+    index->size++;
+    if (index->size * 2 > index->mask) {
+        chunk_index_grow(index);
+    }
+}
+
+int chunk_index_get(const ChunkIndex *index, int p, int q) {
+    unsigned int i = _hash(p, q) & index->mask;
+    const ChunkIndexEntry *entry = index->data + i;
+    while (!EMPTY_SLOT(entry)) {
+        if (entry->p == p && entry->q == q) {
+            return entry->value;
+        }
+        i = (i + 1) & index->mask;
+        entry = index->data + i;
+    }
+    return CHUNK_INDEX_NONE;
+}
+
+// backward-shift deletion: no tombstones, so probe chains never outlive the
+// entries that created them
+int chunk_index_remove(ChunkIndex *index, int p, int q) {
+    unsigned int i = _hash(p, q) & index->mask;
+    ChunkIndexEntry *entry = index->data + i;
+    while (!EMPTY_SLOT(entry)) {
+        if (entry->p == p && entry->q == q) {
+            break;
+        }
+        i = (i + 1) & index->mask;
+        entry = index->data + i;
+    }
+    if (EMPTY_SLOT(entry)) {
+        return 0;
+    }
+    unsigned int hole = i;
+    unsigned int j = (i + 1) & index->mask;
+    while (!EMPTY_SLOT(index->data + j)) {
+        ChunkIndexEntry *other = index->data + j;
+        unsigned int home = _hash(other->p, other->q) & index->mask;
+        // move the entry back unless its home lies cyclically in (hole, j]
+        if (((j - home) & index->mask) >= ((j - hole) & index->mask)) {
+            index->data[hole] = *other;
+            hole = j;
+        }
+        j = (j + 1) & index->mask;
+    }
+    index->data[hole].value = CHUNK_INDEX_NONE;
+    index->size--;
+    return 1;
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+static unsigned int _hash(int p, int q) {
+    unsigned int h = (unsigned int)p * 0x9e3779b1u;
+    h ^= (unsigned int)q + 0x7f4a7c15u + (h << 6) + (h >> 2);
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+static void _clear_entries(ChunkIndexEntry *data, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        data[i].value = CHUNK_INDEX_NONE;
+    }
+}
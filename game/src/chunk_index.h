@@ -0,0 +1,27 @@
+#ifndef _chunk_index_h_
+#define _chunk_index_h_
+
+#define CHUNK_INDEX_NONE (-1)
+
+// open-addressed (p, q) -> slot table, slots are indices into a chunk array
+typedef struct {
+    int p;
+    int q;
+    int value; // CHUNK_INDEX_NONE when the entry is empty
+} ChunkIndexEntry;
+
+typedef struct {
+    unsigned int mask;
+    unsigned int size;
+    ChunkIndexEntry *data;
+} ChunkIndex;
+
+void chunk_index_alloc(ChunkIndex *index, int mask);
+void chunk_index_free(ChunkIndex *index);
+void chunk_index_clear(ChunkIndex *index);
+void chunk_index_grow(ChunkIndex *index);
+void chunk_index_set(ChunkIndex *index, int p, int q, int value);
+int chunk_index_get(const ChunkIndex *index, int p, int q);
+int chunk_index_remove(ChunkIndex *index, int p, int q);
+
+#endif
@@ -1,6 +1,15 @@
+#include <math.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "tinycthread.h"
 #include "chunk_manager.h"
+#include "chunk_cache.h"
+#include "chunk_index.h"
+#include "chunk_queue.h"
+#include "lighting.h"
+#include "thread_pool.h"
+#include "queue.h"
 #include "world_query.h"
 #include "mesher.h"
 #include "item.h" 
@@ -8,60 +17,126 @@
 #include "util.h"
 #include "db.h"
 #include "world.h"
+#include "time.h"
 
-#define WORKERS 4
-#define WORKER_IDLE 0
-#define WORKER_BUSY 1
-#define WORKER_DONE 2
+#define MAX_QUEUE_POPS 256 // queue entries examined per frame at most
+#define MAX_PREFETCH_PATH 64 // predicted path length in chunks at most
+
+typedef enum {
+    JOB_GENERATE, // terrain plus saved blocks and lights of one chunk
+    JOB_MESH, // mesh of one chunk from a snapshot of its 3x3 neighborhood
+    JOB_CACHE // encoding of an evicted chunk for the chunk cache
+} JobType;
 
 typedef struct {
+    ChunkManager *manager;
+    JobType type;
     // inputs
     int p;
     int q;
-    int load;
-    Map *block_maps[3][3];
-    Map *light_maps[3][3];
+    int version; // chunk version at dispatch, older meshes are not uploaded
+    unsigned int sections; // mesh sections to rebuild
+    SignList *signs; // copy for the sign mesh, NULL when the signs did not change
+    double start; // when the job entered its current stage
+    BlockStore *block_stores[3][3];
+    Map *light_maps[3][3]; // light levels for meshing, sources otherwise
+    ChunkCacheData *cached; // decoded instead of generating when set
 
     MesherOutput *output;
 } WorkerItem;
 
+// main thread time and GPU bytes spent on chunks during one update
 typedef struct {
-    int index;
-    int state;
-    thrd_t thrd;
-    mtx_t mtx;
-    cnd_t cnd;
-    WorkerItem item;
-} Worker;
+    double start;
+    size_t bytes;
+} FrameBudget;
 
 struct ChunkManager {
     Chunk chunks[MAX_CHUNKS];
-    Worker workers[WORKERS];
+    ChunkIndex index; // (p, q) -> slot in chunks
+    ChunkQueue queue; // chunks around the player waiting for a job
+    ChunkCache cache; // evicted chunks, compressed
+    ChunkIndex pending_cache; // (p, q) -> version of an eviction still being encoded
+    int queue_ready; // queue holds every chunk in the create radius that needs work
+    int queue_p, queue_q, queue_radius; // player chunk and radius the queue is keyed on
+    // chunks the player is predicted to cross, path[0] is the player's chunk
+    int path_p[MAX_PREFETCH_PATH];
+    int path_q[MAX_PREFETCH_PATH];
+    int path_length;
+    float velocity_x, velocity_z; // blocks per second
+    float prefetch_seconds;
+    ThreadPool *pool;
+    MesherScratch **scratch; // one per pool thread, the last one for the main thread
+    ChunkStageStats stages[CHUNK_STAGE_COUNT]; // main thread only
+    mtx_t done_mtx;
+    Queue *done; // WorkerItems the pool finished, either stage
+    WorkerItem **uploads; // meshed WorkerItems waiting for the GL thread
+    int upload_count;
+    unsigned long long uploaded_bytes;
+    unsigned int forced_meshes;
+    float frame_ms;
+    int version; // last version handed to a chunk
+    float block_estimate; // smoothed blocks per loaded chunk, presizes new block stores
     int chunk_count;
     int create_radius;
     int render_radius;
     int delete_radius;
     int sign_radius;
+    BlockStoreType block_store;
 };
 
 // INTERNAL HELPERS //
-static void _check_workers(ChunkManager *manager, Renderer *renderer);
-static void _generate_and_upload_mesh(ChunkManager *manager, Chunk *chunk, Renderer *renderer);
-static MesherOutput *_get_mesher_chunk_output(WorkerItem *item);
+static void _check_workers(ChunkManager *manager);
+static size_t _generate_and_upload_mesh(ChunkManager *manager, Chunk *chunk, Renderer *renderer);
+static MesherOutput *_get_mesher_chunk_output(ChunkManager *manager, WorkerItem *item);
 static void _update_chunk(Chunk *chunk, MesherOutput *mesher_output, Renderer *renderer);
-static int _worker_run(void *arg);
-static void _initialize_workers(ChunkManager *manager);
+static void _drain_uploads(
+    ChunkManager *manager, const Camera *view, Renderer *renderer, FrameBudget *budget);
+static int _upload_score(ChunkManager *manager, const Camera *view, WorkerItem *item);
+static void _force_chunks(
+    ChunkManager *manager, Renderer *renderer, int p, int q, FrameBudget *budget);
+static int _force_chunk(
+    ChunkManager *manager, Renderer *renderer, int p, int q, FrameBudget *budget);
+static int _budget_left(const FrameBudget *budget);
+static size_t _mesh_bytes(const MesherOutput *output);
+static void _run_job(void *arg);
+static void _finish_stage(ChunkManager *manager, WorkerItem *item, ChunkStage stage);
+static void _release_snapshots(WorkerItem *item);
+static void _free_job(WorkerItem *item);
 static void _create_chunk(ChunkManager *manager, Chunk *chunk, int p, int q);
-static bool _has_lights_in_neighborhood(ChunkManager *manager, Chunk *chunk);
+static void _load_chunk_now(ChunkManager *manager, Chunk *chunk);
+static void _cache_chunk(ChunkManager *manager, Chunk *chunk);
+static void _uncache_chunk(ChunkManager *manager, int p, int q);
 static void _unset_sign(ChunkManager *manager, int x, int y, int z);
 static void _set_light(ChunkManager *manager, int p, int q, int x, int y, int z, int w);
 static void _set_sign(
     ChunkManager *manager, int p, int q, int x, int y, int z, int face, const char *text, int dirty);
 static void _unset_sign_face(ChunkManager *manager, int x, int y, int z, int face);
 static void _init_chunk(ChunkManager *manager, Chunk *chunk, int p, int q);
-static void _ensure_chunks_worker(ChunkManager *manager, const Camera *view, Worker *worker);
+static void _log_edit(Chunk *chunk, int x, int y, int z, int w, int light);
+static void _replay_edits(Chunk *chunk);
+static void _reserve_blocks(ChunkManager *manager, BlockStore *blocks);
+static void _ensure_chunks(ChunkManager *manager, const Camera *view);
+static void _update_queue(ChunkManager *manager, int p, int q, int rekey);
+static int _update_path(ChunkManager *manager, const Camera *view);
+static int _path_distance(ChunkManager *manager, int p, int q);
+static void _enqueue_range(ChunkManager *manager, int p0, int p1, int q0, int q1);
+static void _enqueue_chunk(ChunkManager *manager, int p, int q);
+static int _chunk_score(ChunkManager *manager, int p, int q);
+static int _queue_score(int p, int q, void *arg);
+static int _neighborhood_loaded(ChunkManager *manager, Chunk *chunk);
+static void _on_chunk_loaded(ChunkManager *manager, Chunk *chunk);
+static void _mark_dirty(ChunkManager *manager, Chunk *chunk);
+static void _mark_dirty_sections(ChunkManager *manager, Chunk *chunk, unsigned int sections);
+static unsigned int _take_dirty_sections(Chunk *chunk);
+static void _mark_signs_dirty(ChunkManager *manager, Chunk *chunk);
+static int _take_dirty_signs(Chunk *chunk);
+static int _stage_full(ChunkManager *manager, JobType type);
+static int _dispatch_job(ChunkManager *manager, int p, int q);
 static void _map_set_func(int x, int y, int z, int w, void *arg);
+static void _map_fill_func(int x, int z, int y0, int y1, int w, void *arg);
 static void _load_chunk(WorkerItem *item);
+static void _snapshot_chunk(Chunk *chunk, BlockStore *blocks, Map *lights);
 // ========
 
 ChunkManager *chunk_manager_create(ChunkManagerConfig *config) {
@@ -70,11 +145,43 @@ ChunkManager *chunk_manager_create(ChunkManagerConfig *config) {
         return NULL;
     }
     manager->chunk_count = 0;
+    chunk_index_alloc(&manager->index, MAX_CHUNKS * 2 - 1);
+    chunk_queue_alloc(&manager->queue, 1024);
+    chunk_cache_alloc(&manager->cache, config->cache_memory);
+    chunk_index_alloc(&manager->pending_cache, 0xff);
+    manager->queue_ready = 0;
     manager->create_radius = config->create_radius;
     manager->render_radius = config->render_radius;
     manager->delete_radius = config->delete_radius;
     manager->sign_radius = config->sign_radius;
-    _initialize_workers(manager);
+    manager->block_store = config->block_store;
+    manager->path_length = 0;
+    manager->velocity_x = 0;
+    manager->velocity_z = 0;
+    manager->prefetch_seconds = config->prefetch_seconds;
+    manager->pool = thread_pool_create(WORKER_THREADS);
+    memset(manager->stages, 0, sizeof(manager->stages));
+    int threads = thread_pool_get_thread_count(manager->pool);
+    manager->scratch = (MesherScratch **)malloc(sizeof(MesherScratch *) * (threads + 1));
+    for (int i = 0; i <= threads; i++) {
+        manager->scratch[i] = mesher_scratch_create();
+    }
+    int jobs = threads * JOBS_PER_THREAD;
+    manager->stages[CHUNK_STAGE_GENERATE].capacity = jobs;
+    manager->stages[CHUNK_STAGE_MESH].capacity = jobs;
+    manager->stages[CHUNK_STAGE_UPLOAD].capacity = UPLOAD_QUEUE_SIZE;
+    mtx_init(&manager->done_mtx, mtx_plain);
+    manager->done = queue_create();
+    // backpressure keeps this below the upload capacity plus one batch of meshes
+    manager->uploads = (WorkerItem **)malloc(sizeof(WorkerItem *) * (UPLOAD_QUEUE_SIZE + jobs));
+    manager->upload_count = 0;
+    manager->uploaded_bytes = 0;
+    manager->forced_meshes = 0;
+    manager->frame_ms = 0;
+    manager->version = 0;
+    // with the eighth _reserve_blocks adds, still fits the old fixed 0x7fff
+    // map mask at half load
+    manager->block_estimate = 0x3800;
     return manager;
 }
 void chunk_manager_reset(ChunkManager *manager) {
@@ -82,107 +189,138 @@ void chunk_manager_reset(ChunkManager *manager) {
     for(int i = 0; i < MAX_CHUNKS; ++i) {
         manager->chunks[i].render_id = INVALID_RENDERABLE_OBJECT_ID;
     }
+    chunk_index_clear(&manager->index);
+    chunk_queue_clear(&manager->queue);
+    chunk_cache_clear(&manager->cache);
+    chunk_index_clear(&manager->pending_cache);
+    manager->queue_ready = 0;
     manager->chunk_count = 0;
 }
 void chunk_manager_destroy(ChunkManager *manager, Renderer *renderer) {
     if (manager) {
+        // lets the queued jobs finish so every WorkerItem ends up in done
+        int threads = thread_pool_get_thread_count(manager->pool);
+        thread_pool_destroy(manager->pool);
+        for (int i = 0; i <= threads; i++) {
+            mesher_scratch_destroy(manager->scratch[i]);
+        }
+        free(manager->scratch);
+        while (!queue_is_empty(manager->done)) {
+            _free_job((WorkerItem *)queue_dequeue(manager->done));
+        }
+        for (int i = 0; i < manager->upload_count; i++) {
+            _free_job(manager->uploads[i]);
+        }
+        queue_destroy(manager->done);
+        free(manager->uploads);
+        mtx_destroy(&manager->done_mtx);
         ChunkIterator iterator = chunk_manager_iterator_begin(manager);
         while (chunk_manager_iterator_has_next(&iterator)) {
             Chunk *chunk = chunk_manager_iterator_next(&iterator);
-            map_free(&chunk->map);
+            block_store_free(&chunk->blocks);
             map_free(&chunk->lights);
+            map_free(&chunk->light_levels);
             sign_list_free(&chunk->signs);
+            free(chunk->edits);
             renderer_delete_chunk_geometry(
                 renderer, chunk->render_id);
         }
         manager->chunk_count = 0;
+        chunk_index_free(&manager->index);
+        chunk_queue_free(&manager->queue);
+        chunk_cache_free(&manager->cache);
+        chunk_index_free(&manager->pending_cache);
         free(manager);
     }
 }
 Chunk *chunk_manager_find_chunk(ChunkManager *manager, int p, int q) {
-    for (int i = 0; i < manager->chunk_count; i++) {
-        Chunk *chunk = manager->chunks + i;
-        if (chunk->p == p && chunk->q == q) {
-            return chunk;
-        }
+    int slot = chunk_index_get(&manager->index, p, q);
+    if (slot == CHUNK_INDEX_NONE) {
+        return NULL;
     }
-    return NULL;
+    return manager->chunks + slot;
 }
 void chunk_manager_force_chunks_around_point(ChunkManager *manager, Renderer *renderer, float x, float z) {
-    int p = chunked(x);
-    int q = chunked(z);
-    int r = 1;
-    for (int dp = -r; dp <= r; dp++) {
-        for (int dq = -r; dq <= r; dq++) {
-            int a = p + dp;
-            int b = q + dq;
-            Chunk *chunk = chunk_manager_find_chunk(manager, a, b);
-            if (chunk) {
-                if (chunk->dirty) {
-                    _generate_and_upload_mesh(manager, chunk, renderer);
-                }
-            }
-            else if (manager->chunk_count < MAX_CHUNKS) {
-                chunk = manager->chunks + manager->chunk_count++;
-                _create_chunk(manager, chunk, a, b);
-                _generate_and_upload_mesh(manager, chunk, renderer);
-            }
-        }
-    }
+    _force_chunks(manager, renderer, chunked(x), chunked(z), NULL);
 }
 
 void chunk_manager_update(ChunkManager *manager, const Camera *view, Renderer *renderer) {
-    _check_workers(manager, renderer);
-    chunk_manager_force_chunks_around_point(manager, renderer, view->x, view->z);
-    for (int i = 0; i < WORKERS; i++) {
-        Worker *worker = manager->workers + i;
-        mtx_lock(&worker->mtx);
-        if (worker->state == WORKER_IDLE) {
-            _ensure_chunks_worker(manager, view, worker);
+    FrameBudget budget;
+    budget.start = time_get_seconds();
+    budget.bytes = 0;
+    _check_workers(manager);
+    _force_chunks(manager, renderer, chunked(view->x), chunked(view->z), &budget);
+    _drain_uploads(manager, view, renderer, &budget);
+    manager->frame_ms = (float)((time_get_seconds() - budget.start) * 1000);
+    _ensure_chunks(manager, view);
+}
+// the radii and prefetch can change at any time, the block store and cache
+// size are fixed at creation
+void chunk_manager_apply_config(ChunkManager *manager, const ChunkManagerConfig *config) {
+    manager->create_radius = config->create_radius;
+    manager->render_radius = config->render_radius;
+    manager->delete_radius = config->delete_radius;
+    manager->sign_radius = config->sign_radius;
+    manager->prefetch_seconds = config->prefetch_seconds;
+}
+// chunks going through the pipeline plus the queued chunks that still need
+// a job. Stale queue entries do not count, and the queue is only walked
+// until the backlog reaches limit.
+int chunk_manager_get_backlog(ChunkManager *manager, int limit) {
+    int backlog = 0;
+    for (int i = 0; i < CHUNK_STAGE_COUNT; i++) {
+        backlog += manager->stages[i].depth;
+    }
+    for (unsigned int i = 0; i < manager->queue.size && backlog < limit; i++) {
+        ChunkQueueEntry *entry = manager->queue.data + i;
+        if (_chunk_score(manager, entry->p, entry->q) >= 0) {
+            backlog++;
         }
-        mtx_unlock(&worker->mtx);
     }
+    return backlog;
+}
+void chunk_manager_set_motion(ChunkManager *manager, float vx, float vz) {
+    manager->velocity_x = vx;
+    manager->velocity_z = vz;
 }
 void chunk_manager_set_dirty_chunk(ChunkManager *manager, Chunk *chunk) {
-    chunk->dirty = 1;
-    if (_has_lights_in_neighborhood(manager, chunk))
-    {
-        for (int dp = -1; dp <= 1; dp++)
-        {
-            for (int dq = -1; dq <= 1; dq++)
-            {
-                Chunk *other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
-                if (other)
-                {
-                    other->dirty = 1;
-                }
-            }
-        }
-    }
+    _mark_dirty(manager, chunk);
+}
+// the blocks or light levels from miny to maxy changed, only the mesh
+// sections that read them are rebuilt. The lighting passes dirty the
+// neighbors whose light changes this way.
+void chunk_manager_set_dirty_blocks(ChunkManager *manager, Chunk *chunk, int miny, int maxy) {
+    _mark_dirty_sections(manager, chunk, mesher_sections_reading(miny, maxy));
 }
 void chunk_manager_delete_distant_chunks(ChunkManager *manager, Renderer *renderer, float x, float z) {
+    int p = chunked(x);
+    int q = chunked(z);
     for (int i = 0; i < manager->chunk_count; i++)
     {
         Chunk *chunk = manager->chunks + i;
-        int delete = 1;
-        int p = chunked(x);
-        int q = chunked(z);
         if (chebyshev_distance(p, q, chunk->p, chunk->q) < manager->delete_radius)
         {
-            delete = 0;
-            break;
+            continue;
         }
-
-        if (delete)
-        {
-            map_free(&chunk->map);
+        if (chunk->loaded && manager->cache.capacity) {
+            _cache_chunk(manager, chunk); // takes the block store and lights
+        }
+        else {
+            block_store_free(&chunk->blocks);
             map_free(&chunk->lights);
-            sign_list_free(&chunk->signs);
-            if (chunk->render_id != INVALID_RENDERABLE_OBJECT_ID) {
-                renderer_delete_chunk_geometry(renderer, chunk->render_id);
-            }
-            Chunk *other = manager->chunks + (--manager->chunk_count);
+        }
+        map_free(&chunk->light_levels);
+        sign_list_free(&chunk->signs);
+        free(chunk->edits);
+        if (chunk->render_id != INVALID_RENDERABLE_OBJECT_ID) {
+            renderer_delete_chunk_geometry(renderer, chunk->render_id);
+        }
+        chunk_index_remove(&manager->index, chunk->p, chunk->q);
+        Chunk *other = manager->chunks + (--manager->chunk_count);
+        if (other != chunk) {
             memcpy(chunk, other, sizeof(Chunk));
+            chunk_index_set(&manager->index, chunk->p, chunk->q, i);
+            i--; // the moved chunk still has to be checked
         }
     }
 }
@@ -191,18 +329,26 @@ void _set_block(ChunkManager *manager, int p, int q, int x, int y, int z, int w,
     Chunk *chunk = chunk_manager_find_chunk(manager, p, q);
     if (chunk)
     {
-        Map *map = &chunk->map;
-        if (map_set(map, x, y, z, w))
+        BlockStore *blocks = &chunk->blocks;
+        if (!chunk->loaded)
+        {
+            // the placeholder store does not hold the terrain to compare with
+            _log_edit(chunk, x, y, z, w, 0);
+            block_store_set(blocks, x, y, z, w);
+            db_insert_block(p, q, x, y, z, w);
+        }
+        else if (block_store_set(blocks, x, y, z, w))
         {
             if (dirty)
             {
-                chunk_manager_set_dirty_chunk(manager, chunk);
+                chunk_manager_set_dirty_blocks(manager, chunk, y, y);
             }
             db_insert_block(p, q, x, y, z, w);
         }
     }
     else
     {
+        _uncache_chunk(manager, p, q);
         db_insert_block(p, q, x, y, z, w);
     }
     if (w == 0 && chunked(x) == p && chunked(z) == q)
@@ -214,7 +360,10 @@ void _set_block(ChunkManager *manager, int p, int q, int x, int y, int z, int w,
 void chunk_manager_set_block(ChunkManager *manager, int x, int y, int z, int w) {
     int p = chunked(x);
     int q = chunked(z);
+    Chunk *chunk = chunk_manager_find_chunk(manager, p, q);
+    int was_opaque = chunk && !is_transparent(block_store_get(&chunk->blocks, x, y, z));
     _set_block(manager, p, q, x, y, z, w, 1);
+    lighting_block_changed(manager, x, y, z, was_opaque);
     for (int dx = -1; dx <= 1; dx++)
     {
         for (int dz = -1; dz <= 1; dz++)
@@ -244,7 +393,7 @@ void chunk_manager_toggle_light(ChunkManager *manager, int x, int y, int z) {
         int w = map_get(map, x, y, z) ? 0 : 15;
         map_set(map, x, y, z, w);
         db_insert_light(p, q, x, y, z, w);
-        chunk_manager_set_dirty_chunk(manager, chunk);
+        lighting_source_changed(manager, x, y, z);
     }
 }
 void chunk_manager_set_sign(ChunkManager *manager, int x, int y, int z, int face, const char *text) {
@@ -252,6 +401,24 @@ void chunk_manager_set_sign(ChunkManager *manager, int x, int y, int z, int face
     int q = chunked(z);
     _set_sign(manager, p, q, x, y, z, face, text, 1);
 }
+void chunk_manager_get_stats(ChunkManager *manager, ChunkManagerStats *stats) {
+    stats->chunk_count = manager->chunk_count;
+    stats->copied_bytes = block_store_copied_bytes();
+    stats->worker_threads = thread_pool_get_thread_count(manager->pool);
+    stats->queued_chunks = manager->queue.size;
+    memcpy(stats->stages, manager->stages, sizeof(stats->stages));
+    stats->uploaded_bytes = manager->uploaded_bytes;
+    stats->forced_meshes = manager->forced_meshes;
+    stats->frame_ms = manager->frame_ms;
+    stats->cached_chunks = manager->cache.count;
+    stats->cache_memory = manager->cache.memory;
+    stats->cache_hits = manager->cache.hits;
+    stats->cache_misses = manager->cache.misses;
+    stats->block_memory = 0;
+    for (int i = 0; i < manager->chunk_count; i++) {
+        stats->block_memory += block_store_memory_usage(&manager->chunks[i].blocks);
+    }
+}
 ChunkIterator chunk_manager_iterator_begin(ChunkManager *manager) {
     ChunkIterator iterator;
     iterator.manager = manager;
@@ -281,7 +448,7 @@ static void _set_sign(
         sign_list_add(signs, x, y, z, face, text);
         if (dirty)
         {
-            chunk->dirty = 1;
+            _mark_signs_dirty(manager, chunk);
         }
     }
     db_insert_sign(p, q, x, y, z, face, text);
@@ -295,7 +462,7 @@ static void _unset_sign_face(ChunkManager *manager, int x, int y, int z, int fac
         SignList *signs = &chunk->signs;
         if (sign_list_remove(signs, x, y, z, face))
         {
-            chunk->dirty = 1;
+            _mark_signs_dirty(manager, chunk);
             db_delete_sign(x, y, z, face);
         }
     }
@@ -304,158 +471,588 @@ static void _unset_sign_face(ChunkManager *manager, int x, int y, int z, int fac
         db_delete_sign(x, y, z, face);
     }
 }
+// sizes a new chunk's blocks for the terrain around it, with an eighth to
+// spare, so generating it does not grow the store
+static void _reserve_blocks(ChunkManager *manager, BlockStore *blocks) {
+    unsigned int estimate = (unsigned int)manager->block_estimate;
+    block_store_reserve(blocks, estimate + estimate / 8);
+}
 static void _init_chunk(ChunkManager *manager, Chunk *chunk, int p, int q) {
     chunk->p = p;
     chunk->q = q;
     chunk->render_id = INVALID_RENDERABLE_OBJECT_ID;
-    chunk_manager_set_dirty_chunk(manager, chunk);
+    chunk->dirty = 0;
+    chunk->dirty_sections = 0;
+    chunk->signs_dirty = 1;
+    chunk->busy = 0;
+    chunk->loaded = 0;
+    chunk->version = ++manager->version;
+    chunk_index_set(&manager->index, p, q, (int)(chunk - manager->chunks));
     SignList *signs = &chunk->signs;
     sign_list_alloc(signs, 16);
     db_load_signs(signs, p, q);
-    Map *block_map = &chunk->map;
+    BlockStore *blocks = &chunk->blocks;
     Map *light_map = &chunk->lights;
     int dx = p * CHUNK_SIZE - 1;
     int dy = 0;
     int dz = q * CHUNK_SIZE - 1;
-    map_alloc(block_map, dx, dy, dz, 0x7fff);
+    // a placeholder until the generate stage's stores replace it, not
+    // reserved since it only holds the edits made before that
+    block_store_alloc(blocks, manager->block_store, dx, dy, dz);
     map_alloc(light_map, dx, dy, dz, 0xf);
+    map_alloc(&chunk->light_levels, dx, dy, dz, 0xf);
+    chunk->edits = NULL;
+    chunk->edit_count = 0;
+    chunk->edit_capacity = 0;
+    chunk_manager_set_dirty_chunk(manager, chunk);
 }
-static void _ensure_chunks_worker(ChunkManager *manager, const Camera *view, Worker *worker) {
-    int p = chunked(view->x);
-    int q = chunked(view->z);
-    int r = manager->create_radius;
-    int start = 0x0fffffff;
-    int best_score = start;
-    int best_a = 0;
-    int best_b = 0;
-    for (int dp = -r; dp <= r; dp++) {
-        for (int dq = -r; dq <= r; dq++) {
-            int a = p + dp;
-            int b = q + dq;
-            int index = (ABS(a) ^ ABS(b)) % WORKERS;
-            if (index != worker->index) {
-                continue;
-            }
-            Chunk *chunk = chunk_manager_find_chunk(manager, a, b);
-            if (chunk && !chunk->dirty) {
-                continue;
-            }
-            int distance = MAX(ABS(dp), ABS(dq));
-            int invisible = !world_is_chunk_visible(view, a, b, 0, 256);
-            int priority = 0;
-            if (chunk) {
-                priority = manager->chunks->render_id != INVALID_RENDERABLE_OBJECT_ID && chunk->dirty;
-            }
-            int score = (invisible << 24) | (priority << 16) | distance;
-            if (score < best_score) {
-                best_score = score;
-                best_a = a;
-                best_b = b;
-            }
+// blocks and lights set while the chunk loads only reach its placeholder
+// stores, setting one to 0 may not even change those, so they are kept to
+// be set again on the loaded ones
+static void _log_edit(Chunk *chunk, int x, int y, int z, int w, int light) {
+    if (chunk->edit_count == chunk->edit_capacity) {
+        chunk->edit_capacity = chunk->edit_capacity ? chunk->edit_capacity * 2 : 16;
+        chunk->edits = (ChunkEdit *)realloc(
+            chunk->edits, sizeof(ChunkEdit) * chunk->edit_capacity);
+    }
+    ChunkEdit *edit = chunk->edits + chunk->edit_count++;
+    edit->x = x;
+    edit->y = y;
+    edit->z = z;
+    edit->w = w;
+    edit->light = light;
+}
+static void _replay_edits(Chunk *chunk) {
+    for (int i = 0; i < chunk->edit_count; i++) {
+        ChunkEdit *edit = chunk->edits + i;
+        if (edit->light) {
+            map_set(&chunk->lights, edit->x, edit->y, edit->z, edit->w);
+        }
+        else {
+            block_store_set(&chunk->blocks, edit->x, edit->y, edit->z, edit->w);
         }
     }
-    if (best_score == start) {
+    free(chunk->edits);
+    chunk->edits = NULL;
+    chunk->edit_count = 0;
+    chunk->edit_capacity = 0;
+}
+// hands the best queued chunks to the thread pool while their stage has
+// room. Visible chunks go first, the best invisible ones fill up whatever
+// room remains.
+static void _ensure_chunks(ChunkManager *manager, const Camera *view) {
+    int rekey = _update_path(manager, view);
+    _update_queue(manager, chunked(view->x), chunked(view->z), rekey);
+    ChunkQueueEntry deferred[MAX_QUEUE_POPS];
+    int deferred_count = 0;
+    ChunkQueueEntry entry;
+    for (int i = 0; i < MAX_QUEUE_POPS; i++) {
+        if (_stage_full(manager, JOB_GENERATE) && _stage_full(manager, JOB_MESH)) {
+            break;
+        }
+        if (!chunk_queue_pop(&manager->queue, &entry)) {
+            break;
+        }
+        int score = _chunk_score(manager, entry.p, entry.q);
+        if (score < 0) {
+            continue; // stale, the chunk is done, busy, waiting or out of range
+        }
+        const ChunkQueueEntry *top = chunk_queue_top(&manager->queue);
+        if (score > entry.score && top && score > top->score) {
+            // keyed on an older player position, requeue at its real place
+            chunk_queue_push(&manager->queue, entry.p, entry.q, score);
+            continue;
+        }
+        entry.score = score;
+        JobType type = chunk_manager_find_chunk(manager, entry.p, entry.q) ?
+            JOB_MESH : JOB_GENERATE;
+        if (_stage_full(manager, type) ||
+            !world_is_chunk_visible(view, entry.p, entry.q, 0, 256))
+        {
+            deferred[deferred_count++] = entry;
+            continue;
+        }
+        if (!_dispatch_job(manager, entry.p, entry.q)) {
+            chunk_queue_push(&manager->queue, entry.p, entry.q, score);
+            break;
+        }
+    }
+    for (int i = 0; i < deferred_count; i++) {
+        ChunkQueueEntry *other = deferred + i;
+        int score = _chunk_score(manager, other->p, other->q);
+        if (score < 0) {
+            continue;
+        }
+        JobType type = chunk_manager_find_chunk(manager, other->p, other->q) ?
+            JOB_MESH : JOB_GENERATE;
+        if (!_stage_full(manager, type) && _dispatch_job(manager, other->p, other->q)) {
+            continue;
+        }
+        chunk_queue_push(&manager->queue, other->p, other->q, score);
+    }
+}
+// keeps the queue keyed on the player's chunk and predicted path: the queued
+// chunks are rekeyed when the player changes chunk or the path changes
+// (rekey set), so the ones the player approached move up, and only the
+// chunks of the new square that the old square did not cover are added,
+// also when the radius changed. Entries outside the square drop out when
+// rekeyed or popped. Only a reset refills the whole square. The square
+// reaches one chunk past create_radius, those chunks are only generated so
+// that every chunk inside has its neighbors for meshing.
+static void _update_queue(ChunkManager *manager, int p, int q, int rekey) {
+    int op = manager->queue_p;
+    int oq = manager->queue_q;
+    if (manager->queue_ready && manager->create_radius == manager->queue_radius &&
+        p == op && q == oq && !rekey)
+    {
         return;
     }
-    int a = best_a;
-    int b = best_b;
-    int load = 0;
-    Chunk *chunk = chunk_manager_find_chunk(manager, a, b);
-    if (!chunk) {
-        load = 1;
-        if (manager->chunk_count < MAX_CHUNKS) {
-            chunk = manager->chunks + manager->chunk_count++;
-            _init_chunk(manager, chunk, a, b);
+    int r = manager->create_radius + 1;
+    int old_r = manager->queue_radius + 1;
+    manager->queue_p = p;
+    manager->queue_q = q;
+    manager->queue_radius = manager->create_radius;
+    if (!manager->queue_ready) {
+        chunk_queue_clear(&manager->queue);
+        manager->queue_ready = 1;
+        _enqueue_range(manager, p - r, p + r, q - r, q + r);
+        return;
+    }
+    if (rekey || p != op || q != oq) {
+        chunk_queue_rekey(&manager->queue, _queue_score, manager);
+    }
+    // strips of the new square that the old square did not cover
+    for (int a = p - r; a <= p + r; a++) {
+        if (a < op - old_r || a > op + old_r) {
+            _enqueue_range(manager, a, a, q - r, q + r);
         }
         else {
-            return;
+            _enqueue_range(manager, a, a, q - r, MIN(q + r, oq - old_r - 1));
+            _enqueue_range(manager, a, a, MAX(q - r, oq + old_r + 1), q + r);
         }
     }
-    WorkerItem *item = &worker->item;
-    item->p = chunk->p;
-    item->q = chunk->q;
-    item->load = load;
+}
+// predicts the chunks the player crosses in the next prefetch_seconds from
+// their velocity, or leans one chunk towards where they look when standing
+// still. Returns whether the path changed.
+static int _update_path(ChunkManager *manager, const Camera *view) {
+    float dx = manager->velocity_x * manager->prefetch_seconds;
+    float dz = manager->velocity_z * manager->prefetch_seconds;
+    float length = sqrtf(dx * dx + dz * dz);
+    if (manager->prefetch_seconds && length < CHUNK_SIZE) {
+        // forward is (sin rx, -cos rx), as in the player's motion vector
+        dx = sinf(view->rx) * CHUNK_SIZE;
+        dz = -cosf(view->rx) * CHUNK_SIZE;
+        length = CHUNK_SIZE;
+    }
+    int steps = 0;
+    if (manager->prefetch_seconds) {
+        steps = MIN((int)ceilf(length / CHUNK_SIZE), manager->create_radius);
+        steps = MIN(steps, MAX_PREFETCH_PATH - 1);
+    }
+    int changed = steps + 1 != manager->path_length;
+    for (int k = 0; k <= steps; k++) {
+        float t = steps ? (float)k / steps : 0;
+        int p = chunked(view->x + dx * t);
+        int q = chunked(view->z + dz * t);
+        changed |= k && (manager->path_p[k] != p || manager->path_q[k] != q);
+        manager->path_p[k] = p;
+        manager->path_q[k] = q;
+    }
+    manager->path_length = steps + 1;
+    return changed;
+}
+// queue distance of a chunk, in half chunks: twice the distance from the
+// player, or less near the predicted path where every step along the path
+// costs only half a chunk
+static int _path_distance(ChunkManager *manager, int p, int q) {
+    int distance = 2 * chebyshev_distance(p, q, manager->queue_p, manager->queue_q);
+    for (int k = 1; k < manager->path_length; k++) {
+        int ahead = 2 * chebyshev_distance(p, q, manager->path_p[k], manager->path_q[k]) + k;
+        distance = MIN(distance, ahead);
+    }
+    return distance;
+}
+static void _enqueue_range(ChunkManager *manager, int p0, int p1, int q0, int q1) {
+    for (int a = p0; a <= p1; a++) {
+        for (int b = q0; b <= q1; b++) {
+            _enqueue_chunk(manager, a, b);
+        }
+    }
+}
+static void _enqueue_chunk(ChunkManager *manager, int p, int q) {
+    if (!manager->queue_ready) {
+        return; // the next refill picks it up
+    }
+    int score = _chunk_score(manager, p, q);
+    if (score >= 0) {
+        chunk_queue_push(&manager->queue, p, q, score);
+    }
+}
+// queue key of a chunk that needs a job, -1 when it needs none right now.
+// Missing chunks need generating. Loaded dirty chunks need meshing once all
+// eight neighbors are loaded, they are queued again when the last one lands.
+// Chunks that have no mesh yet come before remeshes, then nearer first.
+static int _chunk_score(ChunkManager *manager, int p, int q) {
+    int distance = chebyshev_distance(p, q, manager->queue_p, manager->queue_q);
+    if (distance > manager->create_radius + 1) {
+        return -1;
+    }
+    Chunk *chunk = chunk_manager_find_chunk(manager, p, q);
+    if (!chunk) {
+        return _path_distance(manager, p, q);
+    }
+    if (distance > manager->create_radius) {
+        return -1;
+    }
+    if (!chunk->loaded || !chunk->dirty || chunk->busy) {
+        return -1;
+    }
+    if (!_neighborhood_loaded(manager, chunk)) {
+        return -1;
+    }
+    int priority = chunk->render_id != INVALID_RENDERABLE_OBJECT_ID;
+    return (priority << 16) | _path_distance(manager, p, q);
+}
+static int _queue_score(int p, int q, void *arg) {
+    return _chunk_score((ChunkManager *)arg, p, q);
+}
+static int _neighborhood_loaded(ChunkManager *manager, Chunk *chunk) {
     for (int dp = -1; dp <= 1; dp++) {
         for (int dq = -1; dq <= 1; dq++) {
-            Chunk *other = chunk;
-            if (dp || dq) {
-                other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
+            Chunk *other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
+            if (!other || !other->loaded) {
+                return 0;
             }
-            if (other) {
-                Map *block_map = malloc(sizeof(Map));
-                map_copy(block_map, &other->map);
+        }
+    }
+    return 1;
+}
+// the chunk and its neighbors may have just become ready for meshing
+static void _on_chunk_loaded(ChunkManager *manager, Chunk *chunk) {
+    float blocks = (float)block_store_size(&chunk->blocks);
+    manager->block_estimate += (blocks - manager->block_estimate) * BLOCK_ESTIMATE_SMOOTHING;
+    lighting_chunk_loaded(manager, chunk);
+    for (int dp = -1; dp <= 1; dp++) {
+        for (int dq = -1; dq <= 1; dq++) {
+            Chunk *other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
+            if (other && other->dirty) {
+                _enqueue_chunk(manager, other->p, other->q);
+            }
+        }
+    }
+}
+static void _mark_dirty(ChunkManager *manager, Chunk *chunk) {
+    _mark_dirty_sections(manager, chunk, MESHER_ALL_SECTIONS);
+}
+static void _mark_dirty_sections(ChunkManager *manager, Chunk *chunk, unsigned int sections) {
+    chunk->dirty_sections |= sections;
+    if (!chunk->dirty) {
+        chunk->dirty = 1;
+        _enqueue_chunk(manager, chunk->p, chunk->q);
+    }
+}
+// the sections a mesh made now has to rebuild, all of them for a chunk
+// that has no mesh yet. The chunk is clean afterwards.
+static unsigned int _take_dirty_sections(Chunk *chunk) {
+    unsigned int sections = chunk->dirty_sections;
+    if (chunk->render_id == INVALID_RENDERABLE_OBJECT_ID) {
+        sections = MESHER_ALL_SECTIONS;
+    }
+    chunk->dirty = 0;
+    chunk->dirty_sections = 0;
+    return sections;
+}
+// the sign mesh is rebuilt with the next mesh, the block sections stay
+static void _mark_signs_dirty(ChunkManager *manager, Chunk *chunk) {
+    chunk->signs_dirty = 1;
+    _mark_dirty_sections(manager, chunk, 0);
+}
+// whether a mesh made now has to rebuild the sign mesh as well
+static int _take_dirty_signs(Chunk *chunk) {
+    int signs = chunk->signs_dirty || chunk->render_id == INVALID_RENDERABLE_OBJECT_ID;
+    chunk->signs_dirty = 0;
+    return signs;
+}
+// meshing also stalls while the GL thread is behind on uploads
+static int _stage_full(ChunkManager *manager, JobType type) {
+    ChunkStageStats *stages = manager->stages;
+    if (type == JOB_GENERATE) {
+        return stages[CHUNK_STAGE_GENERATE].depth >= stages[CHUNK_STAGE_GENERATE].capacity;
+    }
+    return stages[CHUNK_STAGE_MESH].depth >= stages[CHUNK_STAGE_MESH].capacity ||
+        stages[CHUNK_STAGE_UPLOAD].depth >= stages[CHUNK_STAGE_UPLOAD].capacity;
+}
+static int _dispatch_job(ChunkManager *manager, int a, int b) {
+    Chunk *chunk = chunk_manager_find_chunk(manager, a, b);
+    WorkerItem *item = (WorkerItem *)malloc(sizeof(WorkerItem));
+    item->manager = manager;
+    item->start = time_get_seconds();
+    item->output = NULL;
+    item->cached = NULL;
+    item->sections = 0;
+    item->signs = NULL;
+    memset(item->block_stores, 0, sizeof(item->block_stores));
+    memset(item->light_maps, 0, sizeof(item->light_maps));
+    if (!chunk) {
+        if (manager->chunk_count == MAX_CHUNKS) {
+            free(item);
+            return 0;
+        }
+        chunk = manager->chunks + manager->chunk_count++;
+        _init_chunk(manager, chunk, a, b);
+        // filled by the worker and moved into the chunk afterwards
+        int dx = a * CHUNK_SIZE - 1;
+        int dz = b * CHUNK_SIZE - 1;
+        BlockStore *blocks = malloc(sizeof(BlockStore));
+        block_store_alloc(blocks, manager->block_store, dx, 0, dz);
+        _reserve_blocks(manager, blocks);
+        Map *light_map = malloc(sizeof(Map));
+        map_alloc(light_map, dx, 0, dz, 0xf);
+        item->block_stores[1][1] = blocks;
+        item->light_maps[1][1] = light_map;
+        item->cached = chunk_cache_take(&manager->cache, a, b);
+        item->type = JOB_GENERATE;
+        manager->stages[CHUNK_STAGE_GENERATE].depth++;
+    }
+    else {
+        for (int dp = -1; dp <= 1; dp++) {
+            for (int dq = -1; dq <= 1; dq++) {
+                Chunk *other = chunk_manager_find_chunk(manager, a + dp, b + dq);
+                BlockStore *blocks = malloc(sizeof(BlockStore));
                 Map *light_map = malloc(sizeof(Map));
-                map_copy(light_map, &other->lights);
-                item->block_maps[dp + 1][dq + 1] = block_map;
+                _snapshot_chunk(other, blocks, light_map);
+                item->block_stores[dp + 1][dq + 1] = blocks;
                 item->light_maps[dp + 1][dq + 1] = light_map;
             }
-            else {
-                item->block_maps[dp + 1][dq + 1] = 0;
-                item->light_maps[dp + 1][dq + 1] = 0;
-            }
         }
+        item->type = JOB_MESH;
+        item->sections = _take_dirty_sections(chunk);
+        if (_take_dirty_signs(chunk)) {
+            item->signs = malloc(sizeof(SignList));
+            sign_list_copy(item->signs, &chunk->signs);
+        }
+        manager->stages[CHUNK_STAGE_MESH].depth++;
     }
-    chunk->dirty = 0;
-    worker->state = WORKER_BUSY;
-    cnd_signal(&worker->cnd);
+    item->p = a;
+    item->q = b;
+    item->version = chunk->version;
+    chunk->busy = chunk->version; // never 0, versions start at 1
+    thread_pool_submit(manager->pool, _run_job, item);
+    return 1;
 }
 static void _map_set_func(int x, int y, int z, int w, void *arg) {
-    Map *map = (Map *)arg;
-    map_set(map, x, y, z, w);
+    BlockStore *blocks = (BlockStore *)arg;
+    block_store_set(blocks, x, y, z, w);
+}
+static void _map_fill_func(int x, int z, int y0, int y1, int w, void *arg) {
+    BlockStore *blocks = (BlockStore *)arg;
+    block_store_fill(blocks, x, z, y0, y1, w);
 }
 static void _load_chunk(WorkerItem *item) {
     int p = item->p;
     int q = item->q;
-    Map *block_map = item->block_maps[1][1];
+    BlockStore *blocks = item->block_stores[1][1];
     Map *light_map = item->light_maps[1][1];
-    create_world(p, q, _map_set_func, block_map);
-    db_load_blocks(block_map, p, q);
+    if (item->cached) {
+        chunk_cache_decode(item->cached, blocks, light_map);
+        return;
+    }
+    create_world_columns(p, q, _map_set_func, _map_fill_func, blocks);
+    db_load_blocks(blocks, p, q);
     db_load_lights(light_map, p, q);
 }
-static void _check_workers(ChunkManager *manager, Renderer *renderer) {
-    for (int i = 0; i < WORKERS; i++) {
-        Worker *worker = manager->workers + i;
-        mtx_lock(&worker->mtx);
-        if (worker->state == WORKER_DONE) {
-            WorkerItem *item = &worker->item;
-            Chunk *chunk = chunk_manager_find_chunk(manager, item->p, item->q);
-            if (chunk) {
-                if (item->load) {
-                    Map *block_map = item->block_maps[1][1];
-                    Map *light_map = item->light_maps[1][1];
-                    map_free(&chunk->map);
-                    map_free(&chunk->lights);
-                    map_copy(&chunk->map, block_map);
-                    map_copy(&chunk->lights, light_map);
+// read-only view of the chunk's blocks and light levels for a mesh job,
+// released in _check_workers
+static void _snapshot_chunk(Chunk *chunk, BlockStore *blocks, Map *lights) {
+    if (COW_SNAPSHOTS) {
+        block_store_share(blocks, &chunk->blocks);
+        map_share(lights, &chunk->light_levels);
+    }
+    else {
+        block_store_copy(blocks, &chunk->blocks);
+        map_copy(lights, &chunk->light_levels);
+    }
+}
+// takes finished jobs off the pool: generated chunks become resident, meshes
+// move on to the upload stage
+static void _check_workers(ChunkManager *manager) {
+    while (1) {
+        mtx_lock(&manager->done_mtx);
+        WorkerItem *item = (WorkerItem *)queue_dequeue(manager->done);
+        mtx_unlock(&manager->done_mtx);
+        if (!item) {
+            break;
+        }
+        Chunk *chunk = chunk_manager_find_chunk(manager, item->p, item->q);
+        if (item->type == JOB_CACHE) {
+            // only the latest eviction counts, and never while the chunk is back
+            int pending = chunk_index_get(&manager->pending_cache, item->p, item->q);
+            if (pending == item->version) {
+                chunk_index_remove(&manager->pending_cache, item->p, item->q);
+                if (!chunk) {
+                    chunk_cache_put(&manager->cache, item->cached);
+                    item->cached = NULL;
                 }
+            }
+            _free_job(item);
+            continue;
+        }
+        if (item->type == JOB_MESH) {
+            _finish_stage(manager, item, CHUNK_STAGE_MESH);
+            _release_snapshots(item);
+            item->start = time_get_seconds();
+            manager->uploads[manager->upload_count++] = item;
+            manager->stages[CHUNK_STAGE_UPLOAD].depth++;
+            continue;
+        }
+        _finish_stage(manager, item, CHUNK_STAGE_GENERATE);
+        // a chunk deleted while loading may be back with a job of its own,
+        // the old job's stores could predate its edits
+        if (chunk && chunk->busy == item->version) {
+            chunk->busy = 0;
+            if (!chunk->loaded) {
+                // move the freshly loaded stores in, no copy needed
+                block_store_free(&chunk->blocks);
+                map_free(&chunk->lights);
+                chunk->blocks = *item->block_stores[1][1];
+                chunk->lights = *item->light_maps[1][1];
+                free(item->block_stores[1][1]);
+                free(item->light_maps[1][1]);
+                item->block_stores[1][1] = NULL;
+                item->light_maps[1][1] = NULL;
+                _replay_edits(chunk);
+                chunk->loaded = 1;
+                _on_chunk_loaded(manager, chunk);
+            }
+            // else loaded by the force path in the meantime
+        }
+        _free_job(item);
+    }
+}
+// uploads the waiting meshes best first until the frame budget runs out.
+// One upload always goes through so that the stage keeps moving, out of
+// date meshes are dropped for free.
+static void _drain_uploads(
+    ChunkManager *manager, const Camera *view, Renderer *renderer, FrameBudget *budget)
+{
+    int uploaded = 0;
+    while (manager->upload_count) {
+        int best = 0;
+        int best_score = _upload_score(manager, view, manager->uploads[0]);
+        for (int i = 1; i < manager->upload_count; i++) {
+            int score = _upload_score(manager, view, manager->uploads[i]);
+            if (score < best_score) {
+                best = i;
+                best_score = score;
+            }
+        }
+        WorkerItem *item = manager->uploads[best];
+        if (best_score >= 0 && uploaded && !_budget_left(budget)) {
+            break;
+        }
+        manager->uploads[best] = manager->uploads[--manager->upload_count];
+        _finish_stage(manager, item, CHUNK_STAGE_UPLOAD);
+        Chunk *chunk = chunk_manager_find_chunk(manager, item->p, item->q);
+        if (chunk && chunk->busy == item->version) {
+            if (chunk->version == item->version) {
                 _update_chunk(chunk, item->output, renderer);
-                mesher_free_output(&item->output);
+                size_t bytes = _mesh_bytes(item->output);
+                budget->bytes += bytes;
+                manager->uploaded_bytes += bytes;
+                uploaded++;
             }
-            for (int a = 0; a < 3; a++) {
-                for (int b = 0; b < 3; b++) {
-                    Map *block_map = item->block_maps[a][b];
-                    Map *light_map = item->light_maps[a][b];
-                    if (block_map) {
-                        map_free(block_map);
-                        free(block_map);
-                    }
-                    if (light_map) {
-                        map_free(light_map);
-                        free(light_map);
-                    }
-                }
+            else {
+                // the newer mesh may not have redone the sections of this one
+                _mark_dirty_sections(manager, chunk, item->sections);
+                chunk->signs_dirty |= item->output->sign_mesh;
+            }
+            chunk->busy = 0;
+            if (chunk->dirty) {
+                // edited while the job ran
+                _enqueue_chunk(manager, chunk->p, chunk->q);
             }
-            worker->state = WORKER_IDLE;
         }
-        mtx_unlock(&worker->mtx);
+        _free_job(item);
     }
 }
-// generates the chunk buffer and uploads it to the GPU for the dirty chunk
-static void _generate_and_upload_mesh(ChunkManager *manager, Chunk *chunk, Renderer *renderer) {
+// -1 for meshes that will be dropped, then visible before hidden, nearer first
+static int _upload_score(ChunkManager *manager, const Camera *view, WorkerItem *item) {
+    Chunk *chunk = chunk_manager_find_chunk(manager, item->p, item->q);
+    if (!chunk || chunk->version != item->version) {
+        return -1;
+    }
+    int distance = chebyshev_distance(item->p, item->q, chunked(view->x), chunked(view->z));
+    int hidden = !world_is_chunk_visible(
+        view, item->p, item->q, item->output->miny, item->output->maxy);
+    return (hidden << 16) | distance;
+}
+// meshes the chunks around the player on the main thread so there is never
+// a hole under their feet. With a budget only the player's own chunk is
+// certain to be done, the ring around it stops once the budget is spent and
+// is left to the pipeline.
+static void _force_chunks(
+    ChunkManager *manager, Renderer *renderer, int p, int q, FrameBudget *budget)
+{
+    _force_chunk(manager, renderer, p, q, budget);
+    for (int dp = -1; dp <= 1; dp++) {
+        for (int dq = -1; dq <= 1; dq++) {
+            if (!dp && !dq) {
+                continue;
+            }
+            if (budget && !_budget_left(budget)) {
+                return;
+            }
+            _force_chunk(manager, renderer, p + dp, q + dq, budget);
+        }
+    }
+}
+static int _force_chunk(
+    ChunkManager *manager, Renderer *renderer, int p, int q, FrameBudget *budget)
+{
+    Chunk *chunk = chunk_manager_find_chunk(manager, p, q);
+    if (chunk) {
+        if (!chunk->loaded) {
+            // still in the generate stage, do not wait for it
+            _load_chunk_now(manager, chunk);
+        }
+        if (!chunk->dirty) {
+            return 0;
+        }
+    }
+    else if (manager->chunk_count < MAX_CHUNKS) {
+        chunk = manager->chunks + manager->chunk_count++;
+        _create_chunk(manager, chunk, p, q);
+    }
+    else {
+        return 0;
+    }
+    size_t bytes = _generate_and_upload_mesh(manager, chunk, renderer);
+    manager->uploaded_bytes += bytes;
+    manager->forced_meshes++;
+    if (budget) {
+        budget->bytes += bytes;
+    }
+    return 1;
+}
+static int _budget_left(const FrameBudget *budget) {
+    double ms = (time_get_seconds() - budget->start) * 1000;
+    return ms < UPLOAD_MS_PER_FRAME && budget->bytes < UPLOAD_BYTES_PER_FRAME;
+}
+static size_t _mesh_bytes(const MesherOutput *output) {
+    // 4 vertices per block face, 6 of 5 floats per sign face when they changed
+    return MESHER_VERTEX_BYTES(output->packed) * 4 * output->faces +
+        sizeof(GLfloat) * 5 * 6 * output->sign_faces;
+}
+// generates the chunk buffer and uploads it to the GPU for the dirty chunk,
+// returns the bytes uploaded
+static size_t _generate_and_upload_mesh(ChunkManager *manager, Chunk *chunk, Renderer *renderer) {
     WorkerItem _item;
     WorkerItem *item = &_item;
     item->p = chunk->p;
     item->q = chunk->q;
+    item->sections = _take_dirty_sections(chunk);
+    item->signs = _take_dirty_signs(chunk) ? &chunk->signs : NULL;
     for (int dp = -1; dp <= 1; dp++) {
         for (int dq = -1; dq <= 1; dq++) {
             Chunk *other = chunk;
@@ -463,26 +1060,37 @@ static void _generate_and_upload_mesh(ChunkManager *manager, Chunk *chunk, Rende
                 other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
             }
             if (other) {
-                item->block_maps[dp + 1][dq + 1] = &other->map;
-                item->light_maps[dp + 1][dq + 1] = &other->lights;
+                item->block_stores[dp + 1][dq + 1] = &other->blocks;
+                item->light_maps[dp + 1][dq + 1] = &other->light_levels;
             }
             else {
-                item->block_maps[dp + 1][dq + 1] = 0;
+                item->block_stores[dp + 1][dq + 1] = 0;
                 item->light_maps[dp + 1][dq + 1] = 0;
             }
         }
     }
-    MesherOutput *mesher_output = _get_mesher_chunk_output(item); // would return item->output
+    MesherOutput *mesher_output = _get_mesher_chunk_output(manager, item); // would return item->output
     _update_chunk(chunk, mesher_output, renderer);
+    size_t bytes = _mesh_bytes(mesher_output);
     mesher_free_output(&mesher_output);
-    chunk->dirty = 0;
+    chunk->version = ++manager->version; // a mesh job in flight is out of date now
+    return bytes;
 }
 // will store it appropriately in the WorkerItem passed in (more useful for async path)
-static MesherOutput *_get_mesher_chunk_output(WorkerItem *item) {
+static MesherOutput *_get_mesher_chunk_output(ChunkManager *manager, WorkerItem *item) {
+    int thread = thread_pool_get_thread_index(manager->pool);
+    if (thread < 0) {
+        thread = thread_pool_get_thread_count(manager->pool);
+    }
     MesherInput mesher_input;
     mesher_input.p = item->p;
     mesher_input.q = item->q;
-    memcpy(mesher_input.block, item->block_maps, sizeof(item->block_maps));
+    mesher_input.greedy = GREEDY_MESHING;
+    mesher_input.packed = PACKED_VERTICES;
+    mesher_input.sections = item->sections;
+    mesher_input.signs = item->signs;
+    mesher_input.scratch = manager->scratch[thread];
+    memcpy(mesher_input.block, item->block_stores, sizeof(item->block_stores));
     memcpy(mesher_input.light, item->light_maps, sizeof(item->light_maps));
     MesherOutput *mesher_output = mesher_compute_chunk(&mesher_input);
     if (mesher_output) {
@@ -494,78 +1102,113 @@ static MesherOutput *_get_mesher_chunk_output(WorkerItem *item) {
     }
 }
 static void _update_chunk(Chunk *chunk, MesherOutput *mesher_output, Renderer *renderer) {
-    chunk->miny = mesher_output->miny;
-    chunk->maxy = mesher_output->maxy;
-    mesher_generate_sign_mesh(mesher_output, &chunk->signs);
-    renderer_upload_chunk_geometry(renderer, &chunk->render_id, mesher_output); // includes signs
-}
-static int _worker_run(void *arg) { 
-    Worker *worker = (Worker *)arg;
-    int running = 1;
-    while (running) {
-        mtx_lock(&worker->mtx);
-        while (worker->state != WORKER_BUSY) {
-            cnd_wait(&worker->cnd, &worker->mtx);
-        }
-        mtx_unlock(&worker->mtx);
-        WorkerItem *item = &worker->item;
-        if (item->load) {
-            _load_chunk(item);
-        }
-        MesherOutput *mesh_output = _get_mesher_chunk_output(item);
-        mtx_lock(&worker->mtx);
-        worker->state = WORKER_DONE;
-        mtx_unlock(&worker->mtx);
-    }
-    return 0;
-}
-static void _initialize_workers(ChunkManager *manager) {
-    for (int i = 0; i < WORKERS; i++) {
-        Worker *worker = manager->workers + i;
-        worker->index = i;
-        worker->state = WORKER_IDLE;
-        mtx_init(&worker->mtx, mtx_plain);
-        cnd_init(&worker->cnd);
-        thrd_create(&worker->thrd, _worker_run, worker);
+    if (mesher_output->sections == MESHER_ALL_SECTIONS) {
+        chunk->miny = mesher_output->miny;
+        chunk->maxy = mesher_output->maxy;
+    }
+    else {
+        // the kept sections still reach as far as before
+        chunk->miny = MIN(chunk->miny, mesher_output->miny);
+        chunk->maxy = MAX(chunk->maxy, mesher_output->maxy);
     }
+    renderer_upload_chunk_geometry(renderer, &chunk->render_id, mesher_output); // signs too if rebuilt
+}
+static void _run_job(void *arg) {
+    WorkerItem *item = (WorkerItem *)arg;
+    if (item->type == JOB_GENERATE) {
+        _load_chunk(item);
+    }
+    else if (item->type == JOB_CACHE) {
+        item->cached = chunk_cache_encode(
+            item->p, item->q, item->block_stores[1][1], item->light_maps[1][1]);
+    }
+    else {
+        _get_mesher_chunk_output(item->manager, item);
+    }
+    ChunkManager *manager = item->manager;
+    mtx_lock(&manager->done_mtx);
+    queue_enqueue(manager->done, item);
+    mtx_unlock(&manager->done_mtx);
+}
+static void _finish_stage(ChunkManager *manager, WorkerItem *item, ChunkStage stage) {
+    ChunkStageStats *stats = manager->stages + stage;
+    float latency = (float)((time_get_seconds() - item->start) * 1000);
+    stats->depth--;
+    stats->completed++;
+    stats->latency_ms += (latency - stats->latency_ms) * STAGE_LATENCY_SMOOTHING;
+}
+static void _release_snapshots(WorkerItem *item) {
+    for (int a = 0; a < 3; a++) {
+        for (int b = 0; b < 3; b++) {
+            BlockStore *blocks = item->block_stores[a][b];
+            Map *light_map = item->light_maps[a][b];
+            if (blocks) {
+                block_store_free(blocks);
+                free(blocks);
+            }
+            if (light_map) {
+                map_free(light_map);
+                free(light_map);
+            }
+            item->block_stores[a][b] = NULL;
+            item->light_maps[a][b] = NULL;
+        }
+    }
+    if (item->signs) {
+        sign_list_free(item->signs);
+        free(item->signs);
+        item->signs = NULL;
+    }
+}
+// releases the snapshots and mesh of a finished or abandoned job
+static void _free_job(WorkerItem *item) {
+    _release_snapshots(item);
+    mesher_free_output(&item->output);
+    chunk_cache_data_free(&item->cached);
+    free(item);
 }
 static void _create_chunk(ChunkManager *manager, Chunk *chunk, int p, int q) {
     _init_chunk(manager, chunk, p, q);
-
+    _load_chunk_now(manager, chunk);
+}
+// synchronous generate stage for the force path
+static void _load_chunk_now(ChunkManager *manager, Chunk *chunk) {
     WorkerItem _item;
     WorkerItem *item = &_item;
     item->p = chunk->p;
     item->q = chunk->q;
-    item->block_maps[1][1] = &chunk->map;
+    item->block_stores[1][1] = &chunk->blocks;
     item->light_maps[1][1] = &chunk->lights;
+    item->cached = chunk_cache_take(&manager->cache, chunk->p, chunk->q);
+    _reserve_blocks(manager, &chunk->blocks);
     _load_chunk(item);
+    chunk_cache_data_free(&item->cached);
+    _replay_edits(chunk);
+    chunk->loaded = 1;
+    _mark_dirty(manager, chunk);
+    _on_chunk_loaded(manager, chunk);
 }
-static bool _has_lights_in_neighborhood(ChunkManager *manager, Chunk *chunk) {
-    if (!SHOW_LIGHTS)
-    {
-        return false;
-    }
-    for (int dp = -1; dp <= 1; dp++)
-    {
-        for (int dq = -1; dq <= 1; dq++)
-        {
-            Chunk *other = chunk;
-            if (dp || dq)
-            {
-                other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
-            }
-            if (!other)
-            {
-                continue;
-            }
-            Map *map = &other->lights;
-            if (map->size)
-            {
-                return true;
-            }
-        }
-    }
-    return false;
+// hands the chunk's data to a worker for encoding, the result lands in the
+// cache from _check_workers
+static void _cache_chunk(ChunkManager *manager, Chunk *chunk) {
+    WorkerItem *item = (WorkerItem *)calloc(1, sizeof(WorkerItem));
+    item->manager = manager;
+    item->type = JOB_CACHE;
+    item->p = chunk->p;
+    item->q = chunk->q;
+    item->version = chunk->version;
+    item->block_stores[1][1] = malloc(sizeof(BlockStore));
+    item->light_maps[1][1] = malloc(sizeof(Map));
+    *item->block_stores[1][1] = chunk->blocks;
+    *item->light_maps[1][1] = chunk->lights;
+    chunk_cache_remove(&manager->cache, chunk->p, chunk->q);
+    chunk_index_set(&manager->pending_cache, chunk->p, chunk->q, chunk->version);
+    thread_pool_submit(manager->pool, _run_job, item);
+}
+// the chunk changed in the database while it was not loaded
+static void _uncache_chunk(ChunkManager *manager, int p, int q) {
+    chunk_cache_remove(&manager->cache, p, q);
+    chunk_index_remove(&manager->pending_cache, p, q);
 }
 static void _unset_sign(ChunkManager *manager, int x, int y, int z) {
     int p = chunked(x);
@@ -576,7 +1219,7 @@ static void _unset_sign(ChunkManager *manager, int x, int y, int z) {
         SignList *signs = &chunk->signs;
         if (sign_list_remove_all(signs, x, y, z))
         {
-            chunk->dirty = 1;
+            _mark_signs_dirty(manager, chunk);
             db_delete_signs(x, y, z);
         }
     }
@@ -590,14 +1233,21 @@ static void _set_light(ChunkManager *manager, int p, int q, int x, int y, int z,
     if (chunk)
     {
         Map *map = &chunk->lights;
-        if (map_set(map, x, y, z, w))
+        if (!chunk->loaded)
+        {
+            _log_edit(chunk, x, y, z, w, 1);
+            map_set(map, x, y, z, w);
+            db_insert_light(p, q, x, y, z, w);
+        }
+        else if (map_set(map, x, y, z, w))
         {
-            chunk_manager_set_dirty_chunk(manager, chunk);
             db_insert_light(p, q, x, y, z, w);
+            lighting_source_changed(manager, x, y, z);
         }
     }
     else
     {
+        _uncache_chunk(manager, p, q);
         db_insert_light(p, q, x, y, z, w);
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _chunk_manager_h_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "config.h"
 #include "player.h"
 #include "renderer.h"
@@ -13,8 +14,41 @@ typedef struct {
     int render_radius;
     int delete_radius;
     int sign_radius;
+    BlockStoreType block_store;
+    size_t cache_memory; // bytes of compressed evicted chunks kept, 0 disables the cache
+    float prefetch_seconds; // how far ahead chunks on the player's path come first, 0 disables
 } ChunkManagerConfig;
 
+typedef enum {
+    CHUNK_STAGE_GENERATE, // terrain and DB load on the pool
+    CHUNK_STAGE_MESH, // meshing on the pool, needs the 3x3 neighborhood loaded
+    CHUNK_STAGE_UPLOAD, // finished meshes waiting for the GL thread
+    CHUNK_STAGE_COUNT
+} ChunkStage;
+
+typedef struct {
+    int depth; // chunks in the stage
+    int capacity; // no new work enters past this depth
+    float latency_ms; // smoothed time spent in the stage
+    unsigned int completed;
+} ChunkStageStats;
+
+typedef struct {
+    int chunk_count;
+    size_t block_memory; // bytes held by the chunk block stores
+    unsigned long long copied_bytes; // block and light data duplicated so far
+    int worker_threads;
+    int queued_chunks; // entries in the job queue, stale ones included
+    ChunkStageStats stages[CHUNK_STAGE_COUNT];
+    unsigned long long uploaded_bytes; // chunk geometry sent to the GPU so far
+    unsigned int forced_meshes; // chunks meshed on the main thread by the force path
+    float frame_ms; // main thread time of the last update's meshing and uploads
+    int cached_chunks; // evicted chunks in the chunk cache
+    size_t cache_memory;
+    unsigned int cache_hits;
+    unsigned int cache_misses;
+} ChunkManagerStats;
+
 typedef struct ChunkManager ChunkManager;
 
 typedef struct {
@@ -30,11 +64,16 @@ void chunk_manager_destroy(ChunkManager *manager, Renderer *renderer);
 Chunk *chunk_manager_find_chunk(ChunkManager *manager, int p, int q);
 void chunk_manager_force_chunks_around_point(ChunkManager *manager, Renderer *renderer, float x, float z);
 void chunk_manager_update(ChunkManager *manager, const Camera *view, Renderer *renderer);
+void chunk_manager_apply_config(ChunkManager *manager, const ChunkManagerConfig *config);
+void chunk_manager_set_motion(ChunkManager *manager, float vx, float vz); // blocks per second
+int chunk_manager_get_backlog(ChunkManager *manager, int limit); // counts up to limit
 void chunk_manager_set_dirty_chunk(ChunkManager *manager, Chunk *chunk);
+void chunk_manager_set_dirty_blocks(ChunkManager *manager, Chunk *chunk, int miny, int maxy);
 void chunk_manager_delete_distant_chunks(ChunkManager *manager, Renderer *renderer, float x, float z);
 void chunk_manager_set_block(ChunkManager *manager, int x, int y, int z, int w);
 void chunk_manager_toggle_light(ChunkManager *manager, int x, int y, int z);
 void chunk_manager_set_sign(ChunkManager *manager, int x, int y, int z, int face, const char *text);
+void chunk_manager_get_stats(ChunkManager *manager, ChunkManagerStats *stats);
 
 ChunkIterator chunk_manager_iterator_begin(ChunkManager *manager);
 bool chunk_manager_iterator_has_next(ChunkIterator *iterator);
@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include "chunk_queue.h"
+
+// INTERNAL HELPERS //
+static void _sift_up(ChunkQueue *queue, unsigned int i);
+static void _sift_down(ChunkQueue *queue, unsigned int i);
+static int _compare_position(const void *a, const void *b);
+// ========
+
+void chunk_queue_alloc(ChunkQueue *queue, int capacity) {
+    queue->capacity = capacity;
+    queue->size = 0;
+    queue->data = (ChunkQueueEntry *)malloc(sizeof(ChunkQueueEntry) * capacity);
+}
+
+void chunk_queue_free(ChunkQueue *queue) {
+    free(queue->data);
+    queue->data = NULL;
+    queue->size = 0;
+}
+
+void chunk_queue_clear(ChunkQueue *queue) {
+    queue->size = 0;
+}
+
+void chunk_queue_push(ChunkQueue *queue, int p, int q, int score) {
+    if (queue->size == queue->capacity) {
+        queue->capacity *= 2;
+        queue->data = (ChunkQueueEntry *)realloc(
+            queue->data, sizeof(ChunkQueueEntry) * queue->capacity);
+    }
+    ChunkQueueEntry *entry = queue->data + queue->size;
+    entry->p = p;
+    entry->q = q;
+    entry->score = score;
+    _sift_up(queue, queue->size++);
+}
+
+int chunk_queue_pop(ChunkQueue *queue, ChunkQueueEntry *entry) {
+    if (!queue->size) {
+        return 0;
+    }
+    *entry = queue->data[0];
+    queue->data[0] = queue->data[--queue->size];
+    _sift_down(queue, 0);
+    return 1;
+}
+
+const ChunkQueueEntry *chunk_queue_top(const ChunkQueue *queue) {
+    return queue->size ? queue->data : NULL;
+}
+
+// scores every entry again, dropping the ones that score below 0 and the
+// duplicates of a chunk, and rebuilds the heap. Linear in the entries plus
+// the sort that finds the duplicates.
+void chunk_queue_rekey(ChunkQueue *queue, chunk_queue_score_func score, void *arg) {
+    qsort(queue->data, queue->size, sizeof(ChunkQueueEntry), _compare_position);
+    unsigned int size = 0;
+    for (unsigned int i = 0; i < queue->size; i++) {
+        ChunkQueueEntry entry = queue->data[i];
+        if (i && entry.p == queue->data[i - 1].p && entry.q == queue->data[i - 1].q) {
+            continue;
+        }
+        entry.score = score(entry.p, entry.q, arg);
+        if (entry.score >= 0) {
+            queue->data[size++] = entry;
+        }
+    }
+    queue->size = size;
+    for (unsigned int i = size / 2; i > 0; i--) {
+        _sift_down(queue, i - 1);
+    }
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+static void _sift_up(ChunkQueue *queue, unsigned int i) {
+    ChunkQueueEntry entry = queue->data[i];
+    while (i) {
+        unsigned int parent = (i - 1) / 2;
+        if (queue->data[parent].score <= entry.score) {
+            break;
+        }
+        queue->data[i] = queue->data[parent];
+        i = parent;
+    }
+    queue->data[i] = entry;
+}
+static void _sift_down(ChunkQueue *queue, unsigned int i) {
+    if (i >= queue->size) {
+        return;
+    }
+    ChunkQueueEntry entry = queue->data[i];
+    while (1) {
+        unsigned int child = i * 2 + 1;
+        if (child >= queue->size) {
+            break;
+        }
+        if (child + 1 < queue->size &&
+            queue->data[child + 1].score < queue->data[child].score)
+        {
+            child++;
+        }
+        if (entry.score <= queue->data[child].score) {
+            break;
+        }
+        queue->data[i] = queue->data[child];
+        i = child;
+    }
+    queue->data[i] = entry;
+}
+static int _compare_position(const void *a, const void *b) {
+    const ChunkQueueEntry *ea = (const ChunkQueueEntry *)a;
+    const ChunkQueueEntry *eb = (const ChunkQueueEntry *)b;
+    if (ea->p != eb->p) {
+        return ea->p < eb->p ? -1 : 1;
+    }
+    return ea->q < eb->q ? -1 : ea->q > eb->q;
+}
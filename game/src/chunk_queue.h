@@ -0,0 +1,30 @@
+#ifndef _chunk_queue_h_
+#define _chunk_queue_h_
+
+// binary min-heap of chunk coordinates waiting for a worker job. Entries are
+// only updated all at once by chunk_queue_rekey: in between, a chunk may
+// appear more than once or go stale, the consumer checks every entry it pops.
+typedef struct {
+    int p;
+    int q;
+    int score; // lower comes first
+} ChunkQueueEntry;
+
+// score of a chunk now, below 0 when it no longer needs a job
+typedef int (*chunk_queue_score_func)(int p, int q, void *arg);
+
+typedef struct {
+    unsigned int capacity;
+    unsigned int size;
+    ChunkQueueEntry *data;
+} ChunkQueue;
+
+void chunk_queue_alloc(ChunkQueue *queue, int capacity);
+void chunk_queue_free(ChunkQueue *queue);
+void chunk_queue_clear(ChunkQueue *queue);
+void chunk_queue_push(ChunkQueue *queue, int p, int q, int score);
+int chunk_queue_pop(ChunkQueue *queue, ChunkQueueEntry *entry);
+const ChunkQueueEntry *chunk_queue_top(const ChunkQueue *queue); // NULL when empty
+void chunk_queue_rekey(ChunkQueue *queue, chunk_queue_score_func score, void *arg);
+
+#endif
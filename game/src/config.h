@@ -54,6 +54,34 @@
 #define DELETE_CHUNK_RADIUS 14
 #define CHUNK_SIZE 32
 #define COMMIT_INTERVAL 5
+#define USE_SECTION_STORE 1 // paletted sections instead of the hash map for chunk blocks
+#define MAP_SIMD_PROBING 1 // compare 4 (SSE2) or 8 (AVX2) Map slots per probe step
+#define MAP_REHASH_STEP 16 // Map slots a map_set moves to the new table while it resizes
+#define BLOCK_ESTIMATE_SMOOTHING 0.1f // weight of the newest chunk in the blocks expected per chunk
+#define COW_SNAPSHOTS 1 // workers share chunk data copy-on-write instead of copying it
+#define WORKER_THREADS 0 // chunk worker threads, 0 uses one per core minus the main thread
+#define JOBS_PER_THREAD 2 // generate and mesh jobs each kept in flight per worker thread
+#define UPLOAD_QUEUE_SIZE 32 // meshes waiting for the GL thread before meshing stalls
+#define STAGE_LATENCY_SMOOTHING 0.05f // weight of the newest sample in stage latencies
+#define UPLOAD_MS_PER_FRAME 4.0 // main thread time for chunk uploads and forced meshes
+#define UPLOAD_BYTES_PER_FRAME (4 * 1024 * 1024) // chunk geometry sent to the GPU per frame
+#define FRAME_TIME_SAMPLES 512 // frames kept for the frame time percentiles
+#define CHUNK_CACHE_MEMORY (64 * 1024 * 1024) // compressed evicted chunks kept in memory
+#define PREFETCH_SECONDS 3.0f // chunks on the path the player covers in this time come first
+#define MOTION_SMOOTHING 0.2f // weight of the newest frame in the player velocity
+#define GREEDY_MESHING 1 // merge coplanar faces with the same texture and lighting
+#define PACKED_VERTICES 1 // 8 byte chunk vertices instead of 10 floats, see cube.h
+#define MESH_SECTION_HEIGHT 32 // blocks per separately remeshed slice of a chunk mesh, divides 64
+#define RADIUS_GOVERNOR 1 // adapt the chunk radii to the frame time, the radii above are the maximum
+#define TARGET_FPS 30 // frame rate the governor holds
+#define MIN_CHUNK_RADIUS 3 // the governor does not go below this
+#define GOVERNOR_SMOOTHING 0.05f // weight of the newest frame in the governor's frame time
+#define GOVERNOR_SHRINK_ABOVE 1.15f // shrink when frames take this much of the target or more
+#define GOVERNOR_GROW_BELOW 0.7f // grow when frames take this much of the target or less
+#define GOVERNOR_MAX_BACKLOG 8 // and no more chunks than this are waiting for the workers
+#define GOVERNOR_HOLD_SECONDS 2.0 // frame time must stay out of band this long
+#define GOVERNOR_COOLDOWN_SECONDS 3.0 // time between two radius changes at least
+#define GOVERNOR_LOG 1 // print every radius change to stderr, independent of DEBUG
 
 // Maxs
 #define MAX_PLAYERS 128
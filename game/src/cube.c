@@ -34,21 +34,14 @@ void make_cube_faces(
         {{0, 0}, {0, 1}, {1, 0}, {1, 1}},
         {{1, 0}, {1, 1}, {0, 0}, {0, 1}}
     };
-    static const float indices[6][6] = {
-        {0, 3, 2, 0, 1, 3},
-        {0, 3, 1, 0, 2, 3},
-        {0, 3, 2, 0, 1, 3},
-        {0, 3, 1, 0, 2, 3},
-        {0, 3, 2, 0, 1, 3},
-        {0, 3, 1, 0, 2, 3}
-    };
-    static const float flipped[6][6] = {
-        {0, 1, 2, 1, 3, 2},
-        {0, 2, 1, 2, 3, 1},
-        {0, 1, 2, 1, 3, 2},
-        {0, 2, 1, 2, 3, 1},
-        {0, 1, 2, 1, 3, 2},
-        {0, 2, 1, 2, 3, 1}
+    // corners in drawing order, two triangles 0 1 2 and 0 2 3
+    static const int quads[6][4] = {
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1}
     };
     float *d = data;
     float s = 0.0625;
@@ -63,8 +56,9 @@ void make_cube_faces(
         float du = (tiles[i] % 16) * s;
         float dv = (tiles[i] / 16) * s;
         int flip = ao[i][0] + ao[i][3] > ao[i][1] + ao[i][2];
-        for (int v = 0; v < 6; v++) {
-            int j = flip ? flipped[i][v] : indices[i][v];
+        // starting one corner later draws the other diagonal
+        for (int v = 0; v < 4; v++) {
+            int j = quads[i][(v + flip) % 4];
             *(d++) = x + n * positions[i][j][0];
             *(d++) = y + n * positions[i][j][1];
             *(d++) = z + n * positions[i][j][2];
@@ -79,6 +73,71 @@ void make_cube_faces(
     }
 }
 
+// One face of a box of whole blocks centered on x, y, z and sx, sy, sz
+// blocks big, as make_cube_faces would emit it for a single block but with
+// the tile repeated once per block. The atlas cannot repeat a tile, so the
+// uv carries CUBE_SPAN_UV plus CUBE_SPAN_TILE times the tile column or row
+// plus the position in blocks, and the block shader wraps it into the tile.
+void make_cube_face_span(
+    float *data, float ao, float light, int face, int tile,
+    float x, float y, float z, float sx, float sy, float sz)
+{
+    static const float positions[6][4][3] = {
+        {{-1, -1, -1}, {-1, -1, +1}, {-1, +1, -1}, {-1, +1, +1}},
+        {{+1, -1, -1}, {+1, -1, +1}, {+1, +1, -1}, {+1, +1, +1}},
+        {{-1, +1, -1}, {-1, +1, +1}, {+1, +1, -1}, {+1, +1, +1}},
+        {{-1, -1, -1}, {-1, -1, +1}, {+1, -1, -1}, {+1, -1, +1}},
+        {{-1, -1, -1}, {-1, +1, -1}, {+1, -1, -1}, {+1, +1, -1}},
+        {{-1, -1, +1}, {-1, +1, +1}, {+1, -1, +1}, {+1, +1, +1}}
+    };
+    static const float normals[6][3] = {
+        {-1, 0, 0},
+        {+1, 0, 0},
+        {0, +1, 0},
+        {0, -1, 0},
+        {0, 0, -1},
+        {0, 0, +1}
+    };
+    static const float uvs[6][4][2] = {
+        {{0, 0}, {1, 0}, {0, 1}, {1, 1}},
+        {{1, 0}, {0, 0}, {1, 1}, {0, 1}},
+        {{0, 1}, {0, 0}, {1, 1}, {1, 0}},
+        {{0, 0}, {0, 1}, {1, 0}, {1, 1}},
+        {{0, 0}, {0, 1}, {1, 0}, {1, 1}},
+        {{1, 0}, {1, 1}, {0, 0}, {0, 1}}
+    };
+    // the axis u and v run along on each face
+    static const int u_axis[6] = {2, 2, 0, 0, 0, 0};
+    static const int v_axis[6] = {1, 1, 2, 2, 1, 1};
+    // corners in drawing order, two triangles 0 1 2 and 0 2 3
+    static const int quads[6][4] = {
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1}
+    };
+    float *d = data;
+    float center[3] = {x, y, z};
+    float size[3] = {sx, sy, sz};
+    float du = CUBE_SPAN_UV + (tile % 16) * CUBE_SPAN_TILE;
+    float dv = CUBE_SPAN_UV + (tile / 16) * CUBE_SPAN_TILE;
+    for (int v = 0; v < 4; v++) {
+        int j = quads[face][v];
+        for (int a = 0; a < 3; a++) {
+            *(d++) = center[a] + positions[face][j][a] * size[a] / 2;
+        }
+        *(d++) = normals[face][0];
+        *(d++) = normals[face][1];
+        *(d++) = normals[face][2];
+        *(d++) = du + uvs[face][j][0] * size[u_axis[face]];
+        *(d++) = dv + uvs[face][j][1] * size[v_axis[face]];
+        *(d++) = ao;
+        *(d++) = light;
+    }
+}
+
 void make_cube(
     float *data, float ao[6][4], float light[6][4],
     int left, int right, int top, int bottom, int front, int back,
@@ -119,11 +178,12 @@ void make_plant(
         {{0, 0}, {0, 1}, {1, 0}, {1, 1}},
         {{1, 0}, {1, 1}, {0, 0}, {0, 1}}
     };
-    static const float indices[4][6] = {
-        {0, 3, 2, 0, 1, 3},
-        {0, 3, 1, 0, 2, 3},
-        {0, 3, 2, 0, 1, 3},
-        {0, 3, 1, 0, 2, 3}
+    // corners in drawing order, two triangles 0 1 2 and 0 2 3
+    static const int quads[4][4] = {
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1}
     };
     float *d = data;
     float s = 0.0625;
@@ -132,8 +192,8 @@ void make_plant(
     float du = (plants[w] % 16) * s;
     float dv = (plants[w] / 16) * s;
     for (int i = 0; i < 4; i++) {
-        for (int v = 0; v < 6; v++) {
-            int j = indices[i][v];
+        for (int v = 0; v < 4; v++) {
+            int j = quads[i][v];
             *(d++) = n * positions[i][j][0];
             *(d++) = n * positions[i][j][1];
             *(d++) = n * positions[i][j][2];
@@ -151,10 +211,135 @@ void make_plant(
     mat_identity(ma);
     mat_rotate(mb, 0, 1, 0, RADIANS(rotation));
     mat_multiply(ma, mb, ma);
-    mat_apply(data, ma, 24, 3, 10);
+    mat_apply(data, ma, 16, 3, 10);
     mat_translate(mb, px, py, pz);
     mat_multiply(ma, mb, ma);
-    mat_apply(data, ma, 24, 0, 10);
+    mat_apply(data, ma, 16, 0, 10);
+}
+
+// Packed chunk vertices, see cube.h. Corners are whole blocks from the
+// chunk origin, ao and light are stored in the steps occlusion() makes.
+static void _pack_vertex(
+    unsigned short *d, int x, int y, int z, int kind, int tile,
+    float ao, float light, int u, int v, int h, int rotation)
+{
+    int a = MIN(MAX((int)(ao * 32 + 0.5), 0), 32);
+    int b = MIN(MAX((int)(light * 60 + 0.5), 0), 60); // light blocks saturate at 1
+    d[0] = x | z << 6 | kind << 12;
+    d[1] = y | u << 9 | v << 10 | h << 11;
+    d[2] = tile | a << 8;
+    d[3] = b | rotation << 6;
+}
+
+void make_cube_packed(
+    unsigned short *data, float ao[6][4], float light[6][4],
+    int left, int right, int top, int bottom, int front, int back,
+    int x, int y, int z, int w)
+{
+    static const int positions[6][4][3] = {
+        {{0, 0, 0}, {0, 0, 1}, {0, 1, 0}, {0, 1, 1}},
+        {{1, 0, 0}, {1, 0, 1}, {1, 1, 0}, {1, 1, 1}},
+        {{0, 1, 0}, {0, 1, 1}, {1, 1, 0}, {1, 1, 1}},
+        {{0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1}},
+        {{0, 0, 0}, {0, 1, 0}, {1, 0, 0}, {1, 1, 0}},
+        {{0, 0, 1}, {0, 1, 1}, {1, 0, 1}, {1, 1, 1}}
+    };
+    // corners in drawing order, two triangles 0 1 2 and 0 2 3
+    static const int quads[6][4] = {
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1}
+    };
+    unsigned short *d = data;
+    int faces[6] = {left, right, top, bottom, front, back};
+    for (int i = 0; i < 6; i++) {
+        if (faces[i] == 0) {
+            continue;
+        }
+        int flip = ao[i][0] + ao[i][3] > ao[i][1] + ao[i][2];
+        // starting one corner later draws the other diagonal
+        for (int v = 0; v < 4; v++) {
+            int j = quads[i][(v + flip) % 4];
+            _pack_vertex(d,
+                x + positions[i][j][0], y + positions[i][j][1], z + positions[i][j][2],
+                i, blocks[w][i], ao[i][j], light[i][j], 0, 0, 0, 0);
+            d += CUBE_PACKED_COMPONENTS;
+        }
+    }
+}
+
+void make_cube_face_span_packed(
+    unsigned short *data, float ao, float light, int face, int tile,
+    int x, int y, int z, int sx, int sy, int sz)
+{
+    static const int positions[6][4][3] = {
+        {{0, 0, 0}, {0, 0, 1}, {0, 1, 0}, {0, 1, 1}},
+        {{1, 0, 0}, {1, 0, 1}, {1, 1, 0}, {1, 1, 1}},
+        {{0, 1, 0}, {0, 1, 1}, {1, 1, 0}, {1, 1, 1}},
+        {{0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1}},
+        {{0, 0, 0}, {0, 1, 0}, {1, 0, 0}, {1, 1, 0}},
+        {{0, 0, 1}, {0, 1, 1}, {1, 0, 1}, {1, 1, 1}}
+    };
+    // corners in drawing order, two triangles 0 1 2 and 0 2 3
+    static const int quads[6][4] = {
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1}
+    };
+    unsigned short *d = data;
+    for (int v = 0; v < 4; v++) {
+        int j = quads[face][v];
+        _pack_vertex(d,
+            x + positions[face][j][0] * sx,
+            y + positions[face][j][1] * sy,
+            z + positions[face][j][2] * sz,
+            face, tile, ao, light, 0, 0, 0, 0);
+        d += CUBE_PACKED_COMPONENTS;
+    }
+}
+
+void make_plant_packed(
+    unsigned short *data, float ao, float light,
+    int x, int y, int z, int w, float rotation)
+{
+    // uv of each corner and which end of the quad it is on, the first two
+    // quads run along z and the others along x before the rotation
+    static const int uvs[4][4][2] = {
+        {{0, 0}, {1, 0}, {0, 1}, {1, 1}},
+        {{1, 0}, {0, 0}, {1, 1}, {0, 1}},
+        {{0, 0}, {0, 1}, {1, 0}, {1, 1}},
+        {{1, 0}, {1, 1}, {0, 0}, {0, 1}}
+    };
+    static const int horizontal[4][4] = {
+        {0, 1, 0, 1},
+        {0, 1, 0, 1},
+        {0, 0, 1, 1},
+        {0, 0, 1, 1}
+    };
+    // corners in drawing order, two triangles 0 1 2 and 0 2 3
+    static const int quads[4][4] = {
+        {0, 1, 3, 2},
+        {0, 2, 3, 1},
+        {0, 1, 3, 2},
+        {0, 2, 3, 1}
+    };
+    static const int kinds[4] = {0, 1, 4, 5};
+    int turn = (int)floorf(rotation / 360 * 256 + 0.5) & 255;
+    unsigned short *d = data;
+    for (int i = 0; i < 4; i++) {
+        for (int v = 0; v < 4; v++) {
+            int j = quads[i][v];
+            _pack_vertex(d, x, y, z, CUBE_PACKED_PLANT + kinds[i], plants[w], ao, light,
+                uvs[i][j][0], uvs[i][j][1], horizontal[i][j], turn);
+            d += CUBE_PACKED_COMPONENTS;
+        }
+    }
 }
 
 void make_player(
@@ -182,10 +367,10 @@ void make_player(
     mat_multiply(ma, mb, ma);
     mat_rotate(mb, cosf(rx), 0, sinf(rx), -ry);
     mat_multiply(ma, mb, ma);
-    mat_apply(data, ma, 36, 3, 10);
+    mat_apply(data, ma, 24, 3, 10);
     mat_translate(mb, x, y, z);
     mat_multiply(ma, mb, ma);
-    mat_apply(data, ma, 36, 0, 10);
+    mat_apply(data, ma, 24, 0, 10);
 }
 
 void make_cube_wireframe(float *data, float x, float y, float z, float n) {
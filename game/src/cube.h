@@ -1,12 +1,22 @@
 #ifndef _cube_h_
 #define _cube_h_
 
+// Faces are quads of four vertices, the renderer draws each as the
+// triangles 0 1 2 and 0 2 3 through one index buffer shared by all meshes.
+
 void make_cube_faces(
     float *data, float ao[6][4], float light[6][4],
     int left, int right, int top, int bottom, int front, int back,
     int wleft, int wright, int wtop, int wbottom, int wfront, int wback,
     float x, float y, float z, float n);
 
+#define CUBE_SPAN_UV 2 // uvs at or above this belong to make_cube_face_span
+#define CUBE_SPAN_TILE 512 // more than the longest span in blocks
+
+void make_cube_face_span(
+    float *data, float ao, float light, int face, int tile,
+    float x, float y, float z, float sx, float sy, float sz);
+
 void make_cube(
     float *data, float ao[6][4], float light[6][4],
     int left, int right, int top, int bottom, int front, int back,
@@ -16,6 +26,30 @@ void make_plant(
     float *data, float ao, float light,
     float px, float py, float pz, float n, int w, float rotation);
 
+// Chunk vertices packed into CUBE_PACKED_COMPONENTS unsigned shorts, made
+// for block_vertex.glsl with packed set, positions relative to the chunk:
+//   x | z << 6 | kind << 12  corner in blocks, kind is the face
+//   y | u << 9 | v << 10 | h << 11
+//   tile | ao * 32 << 8
+//   light * 60 | rotation << 6
+// Plants set CUBE_PACKED_PLANT in kind and store their block instead of a
+// corner, the shader turns the quad by rotation / 256 of a full turn.
+#define CUBE_PACKED_COMPONENTS 4
+#define CUBE_PACKED_PLANT 8
+
+void make_cube_packed(
+    unsigned short *data, float ao[6][4], float light[6][4],
+    int left, int right, int top, int bottom, int front, int back,
+    int x, int y, int z, int w);
+
+void make_cube_face_span_packed(
+    unsigned short *data, float ao, float light, int face, int tile,
+    int x, int y, int z, int sx, int sy, int sz);
+
+void make_plant_packed(
+    unsigned short *data, float ao, float light,
+    int x, int y, int z, int w, float rotation);
+
 void make_player(
     float *data,
     float x, float y, float z, float rx, float ry);
@@ -401,7 +401,7 @@ void db_delete_all_signs() {
     sqlite3_exec(db, "delete from sign;", NULL, NULL, NULL);
 }
 
-void db_load_blocks(Map *map, int p, int q) {
+void db_load_blocks(BlockStore *blocks, int p, int q) {
     if (!db_enabled) {
         return;
     }
@@ -414,7 +414,7 @@ void db_load_blocks(Map *map, int p, int q) {
         int y = sqlite3_column_int(load_blocks_stmt, 1);
         int z = sqlite3_column_int(load_blocks_stmt, 2);
         int w = sqlite3_column_int(load_blocks_stmt, 3);
-        map_set(map, x, y, z, w);
+        block_store_set(blocks, x, y, z, w);
     }
     mtx_unlock(&load_mtx);
 }
@@ -2,6 +2,7 @@
 #define _db_h_
 
 #include "map.h"
+#include "block_store.h"
 #include "sign.h"
 
 void db_enable();
@@ -28,7 +29,7 @@ void db_insert_sign(
 void db_delete_sign(int x, int y, int z, int face);
 void db_delete_signs(int x, int y, int z);
 void db_delete_all_signs();
-void db_load_blocks(Map *map, int p, int q);
+void db_load_blocks(BlockStore *blocks, int p, int q);
 void db_load_lights(Map *map, int p, int q);
 void db_load_signs(SignList *list, int p, int q);
 int db_get_key(int p, int q);
@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include "lighting.h"
+#include "config.h"
+#include "item.h"
+#include "util.h"
+
+typedef struct {
+    int x, y, z;
+    int w; // level the cell had when it was queued for removal
+} LightNode;
+
+// FIFO of cells, nothing is dequeued for good until the pass is over
+typedef struct {
+    int head;
+    int count;
+    int capacity;
+    LightNode *data;
+} LightQueue;
+
+static const int neighbors[6][3] = {
+    {-1, 0, 0}, {+1, 0, 0}, {0, -1, 0}, {0, +1, 0}, {0, 0, -1}, {0, 0, +1}
+};
+
+// INTERNAL HELPERS //
+static Chunk *_owner(ChunkManager *manager, int x, int y, int z);
+static int _is_opaque(Chunk *chunk, int x, int y, int z);
+static void _set_level(ChunkManager *manager, Chunk *chunk, int x, int y, int z, int w);
+static void _push(LightQueue *queue, int x, int y, int z, int w);
+static void _spread(ChunkManager *manager, LightQueue *added);
+static void _unspread(ChunkManager *manager, LightQueue *removed, LightQueue *added);
+// ========
+
+// lights the new chunk from its own sources and from the lit cells of its
+// loaded neighbors along the shared faces
+void lighting_chunk_loaded(ChunkManager *manager, Chunk *chunk) {
+    if (!SHOW_LIGHTS) {
+        return;
+    }
+    LightQueue added = {0, 0, 0, NULL};
+    MAP_FOR_EACH((&chunk->lights), ex, ey, ez, ew) {
+        if (ew > map_get(&chunk->light_levels, ex, ey, ez)) {
+            _set_level(manager, chunk, ex, ey, ez, ew);
+            _push(&added, ex, ey, ez, 0);
+        }
+    } END_MAP_FOR_EACH;
+    int x0 = chunk->p * CHUNK_SIZE;
+    int z0 = chunk->q * CHUNK_SIZE;
+    static const int sides[4][2] = {{-1, 0}, {+1, 0}, {0, -1}, {0, +1}};
+    for (int side = 0; side < 4; side++) {
+        int dp = sides[side][0];
+        int dq = sides[side][1];
+        Chunk *other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
+        if (!other || !other->loaded) {
+            continue;
+        }
+        // the other chunk's row of cells facing this one
+        int x = dp < 0 ? x0 - 1 : x0 + CHUNK_SIZE;
+        int z = dq < 0 ? z0 - 1 : z0 + CHUNK_SIZE;
+        Map *levels = &other->light_levels;
+        MAP_FOR_EACH(levels, ex, ey, ez, ew) {
+            if (ew > 1 && ((dp && ex == x) || (dq && ez == z))) {
+                _push(&added, ex, ey, ez, 0);
+            }
+        } END_MAP_FOR_EACH;
+    }
+    _spread(manager, &added);
+    free(added.data);
+}
+// the source at x, y, z in Chunk.lights was set, changed or removed
+void lighting_source_changed(ChunkManager *manager, int x, int y, int z) {
+    Chunk *chunk = _owner(manager, x, y, z);
+    if (!SHOW_LIGHTS || !chunk) {
+        return;
+    }
+    LightQueue added = {0, 0, 0, NULL};
+    LightQueue removed = {0, 0, 0, NULL};
+    int source = map_get(&chunk->lights, x, y, z);
+    int level = map_get(&chunk->light_levels, x, y, z);
+    if (source > level) {
+        _set_level(manager, chunk, x, y, z, source);
+        _push(&added, x, y, z, 0);
+    }
+    else if (source < level) {
+        // take away everything the old level lit, then refill from the edges
+        _set_level(manager, chunk, x, y, z, 0);
+        _push(&removed, x, y, z, level);
+        if (source) {
+            _set_level(manager, chunk, x, y, z, source);
+            _push(&added, x, y, z, 0);
+        }
+    }
+    _unspread(manager, &removed, &added);
+    _spread(manager, &added);
+    free(added.data);
+    free(removed.data);
+}
+// the block at x, y, z changed, light now passes through it or stops at it
+void lighting_block_changed(ChunkManager *manager, int x, int y, int z, int was_opaque) {
+    Chunk *chunk = _owner(manager, x, y, z);
+    if (!SHOW_LIGHTS || !chunk) {
+        return;
+    }
+    int opaque = _is_opaque(chunk, x, y, z);
+    if (opaque == was_opaque || map_get(&chunk->lights, x, y, z)) {
+        return; // sources shine regardless of their block
+    }
+    LightQueue added = {0, 0, 0, NULL};
+    LightQueue removed = {0, 0, 0, NULL};
+    if (opaque) {
+        int level = map_get(&chunk->light_levels, x, y, z);
+        if (level) {
+            _set_level(manager, chunk, x, y, z, 0);
+            _push(&removed, x, y, z, level);
+        }
+    }
+    else {
+        for (int i = 0; i < 6; i++) {
+            int nx = x + neighbors[i][0];
+            int ny = y + neighbors[i][1];
+            int nz = z + neighbors[i][2];
+            Chunk *other = _owner(manager, nx, ny, nz);
+            if (other && map_get(&other->light_levels, nx, ny, nz) > 1) {
+                _push(&added, nx, ny, nz, 0);
+            }
+        }
+    }
+    _unspread(manager, &removed, &added);
+    _spread(manager, &added);
+    free(added.data);
+    free(removed.data);
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+// the loaded chunk the cell belongs to, NULL when light cannot go there
+static Chunk *_owner(ChunkManager *manager, int x, int y, int z) {
+    if (y < 0 || y > 255) {
+        return NULL;
+    }
+    Chunk *chunk = chunk_manager_find_chunk(manager, chunked(x), chunked(z));
+    return chunk && chunk->loaded ? chunk : NULL;
+}
+static int _is_opaque(Chunk *chunk, int x, int y, int z) {
+    return !is_transparent(block_store_get(&chunk->blocks, x, y, z));
+}
+// meshes read the levels one block past their own chunk, so a cell on the
+// edge dirties the neighbors it touches as well
+static void _set_level(ChunkManager *manager, Chunk *chunk, int x, int y, int z, int w) {
+    map_set(&chunk->light_levels, x, y, z, w);
+    int lx = x - chunk->p * CHUNK_SIZE;
+    int lz = z - chunk->q * CHUNK_SIZE;
+    int p0 = lx == 0 ? -1 : 0;
+    int p1 = lx == CHUNK_SIZE - 1 ? 1 : 0;
+    int q0 = lz == 0 ? -1 : 0;
+    int q1 = lz == CHUNK_SIZE - 1 ? 1 : 0;
+    for (int dp = p0; dp <= p1; dp++) {
+        for (int dq = q0; dq <= q1; dq++) {
+            Chunk *other = chunk;
+            if (dp || dq) {
+                other = chunk_manager_find_chunk(manager, chunk->p + dp, chunk->q + dq);
+            }
+            if (other) {
+                chunk_manager_set_dirty_blocks(manager, other, y, y);
+            }
+        }
+    }
+}
+static void _push(LightQueue *queue, int x, int y, int z, int w) {
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 256;
+        queue->data = (LightNode *)realloc(queue->data, sizeof(LightNode) * queue->capacity);
+    }
+    LightNode *node = queue->data + queue->count++;
+    node->x = x;
+    node->y = y;
+    node->z = z;
+    node->w = w;
+}
+// every queued cell passes its level less one on to the transparent
+// neighbors that are darker
+static void _spread(ChunkManager *manager, LightQueue *added) {
+    while (added->head < added->count) {
+        LightNode node = added->data[added->head++];
+        Chunk *chunk = _owner(manager, node.x, node.y, node.z);
+        if (!chunk) {
+            continue;
+        }
+        int w = map_get(&chunk->light_levels, node.x, node.y, node.z) - 1;
+        if (w <= 0) {
+            continue;
+        }
+        for (int i = 0; i < 6; i++) {
+            int nx = node.x + neighbors[i][0];
+            int ny = node.y + neighbors[i][1];
+            int nz = node.z + neighbors[i][2];
+            Chunk *other = _owner(manager, nx, ny, nz);
+            if (!other || _is_opaque(other, nx, ny, nz)) {
+                continue;
+            }
+            if (map_get(&other->light_levels, nx, ny, nz) >= w) {
+                continue;
+            }
+            _set_level(manager, other, nx, ny, nz, w);
+            _push(added, nx, ny, nz, 0);
+        }
+    }
+}
+// clears the cells that were lit from the removed ones. Neighbors at least
+// as bright are lit from elsewhere and queued to refill the hole, sources
+// caught in the hole are queued with their own level.
+static void _unspread(ChunkManager *manager, LightQueue *removed, LightQueue *added) {
+    while (removed->head < removed->count) {
+        LightNode node = removed->data[removed->head++];
+        for (int i = 0; i < 6; i++) {
+            int nx = node.x + neighbors[i][0];
+            int ny = node.y + neighbors[i][1];
+            int nz = node.z + neighbors[i][2];
+            Chunk *other = _owner(manager, nx, ny, nz);
+            if (!other) {
+                continue;
+            }
+            int w = map_get(&other->light_levels, nx, ny, nz);
+            if (!w) {
+                continue;
+            }
+            if (w >= node.w) {
+                _push(added, nx, ny, nz, 0);
+                continue;
+            }
+            _set_level(manager, other, nx, ny, nz, 0);
+            _push(removed, nx, ny, nz, w);
+            int source = map_get(&other->lights, nx, ny, nz);
+            if (source) {
+                _set_level(manager, other, nx, ny, nz, source);
+                _push(added, nx, ny, nz, 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef _lighting_h_
+#define _lighting_h_
+
+#include "chunk.h"
+#include "chunk_manager.h"
+
+// Block light spread from the sources in Chunk.lights into
+// Chunk.light_levels, one level less per block through transparent blocks.
+// The levels are kept up to date by breadth first passes over the cells an
+// edit affects, on the main thread, and only spread through loaded chunks.
+// Every chunk whose mesh sees a changed level is marked dirty.
+
+void lighting_chunk_loaded(ChunkManager *manager, Chunk *chunk);
+void lighting_source_changed(ChunkManager *manager, int x, int y, int z);
+void lighting_block_changed(ChunkManager *manager, int x, int y, int z, int was_opaque);
+
+#endif
@@ -20,6 +20,7 @@
 #include "world_query.h"
 #include "time.h"
 #include "game_clock.h"
+#include "radius_governor.h"
 #include <GLFW/glfw3.h>
 
 #define ASCII_MODE
@@ -35,6 +36,8 @@ typedef struct
     Window *window;
     Renderer *renderer;
     ChunkManager *chunk_manager;
+    ChunkManagerConfig chunk_config; // radii currently in use
+    RadiusGovernor governor;
     InputManager *input_manager;
     Player local_player;
     int item_index;
@@ -79,7 +82,7 @@ void proceed_render_signs(const Camera *view) {
     ChunkIterator it = chunk_manager_iterator_begin(g->chunk_manager);
     while(chunk_manager_iterator_has_next(&it)) {
         Chunk *chunk = chunk_manager_iterator_next(&it);
-        if (chebyshev_distance(chunk->p, chunk->q, p, q) > RENDER_SIGN_RADIUS)
+        if (chebyshev_distance(chunk->p, chunk->q, p, q) > g->chunk_config.sign_radius)
         {
             continue;
         }
@@ -239,9 +242,37 @@ void retrieve_camera_view_params(Player *player, Camera *view) {
     view->fov = g->fov;
     view->ortho = g->ortho;
     window_get_size(g->window, &view->window_width, &view->window_height);
-    view->render_radius = RENDER_CHUNK_RADIUS;
+    view->render_radius = g->chunk_config.render_radius;
     camera_update_matrices(view);
 }
+#if DEBUG
+void log_stats(const FPS *fps, const FrameTimes *frame_times) {
+    static unsigned long long last_copied_bytes = 0;
+    ChunkManagerStats stats;
+    chunk_manager_get_stats(g->chunk_manager, &stats);
+    ChunkStageStats *stages = stats.stages;
+    LOG("fps %u, chunks %d, block memory %.1f MB, copied %.1f MB/s, "
+        "%d threads, queued %d\n",
+        fps->fps, stats.chunk_count, stats.block_memory / (1024.0 * 1024.0),
+        (stats.copied_bytes - last_copied_bytes) / (1024.0 * 1024.0),
+        stats.worker_threads, stats.queued_chunks);
+    LOG("  frame p50 %.1f ms, p99 %.1f ms, chunk work %.1f ms, forced %u, "
+        "uploaded %.1f MB\n",
+        frame_times_percentile(frame_times, 50), frame_times_percentile(frame_times, 99),
+        stats.frame_ms, stats.forced_meshes, stats.uploaded_bytes / (1024.0 * 1024.0));
+    LOG("  cache %d chunks %.1f MB, %u hits, %u misses\n",
+        stats.cached_chunks, stats.cache_memory / (1024.0 * 1024.0),
+        stats.cache_hits, stats.cache_misses);
+    LOG("  generate %d/%d %.1f ms, mesh %d/%d %.1f ms, upload %d/%d %.1f ms\n",
+        stages[CHUNK_STAGE_GENERATE].depth, stages[CHUNK_STAGE_GENERATE].capacity,
+        stages[CHUNK_STAGE_GENERATE].latency_ms,
+        stages[CHUNK_STAGE_MESH].depth, stages[CHUNK_STAGE_MESH].capacity,
+        stages[CHUNK_STAGE_MESH].latency_ms,
+        stages[CHUNK_STAGE_UPLOAD].depth, stages[CHUNK_STAGE_UPLOAD].capacity,
+        stages[CHUNK_STAGE_UPLOAD].latency_ms);
+    last_copied_bytes = stats.copied_bytes;
+}
+#endif
 void load_shaders() {
     renderer_load_block_shaders(g->renderer);
     renderer_load_line_shaders(g->renderer);
@@ -264,12 +295,17 @@ int initialize_main_game_core() {
 
     renderer_global_init();
     g->renderer = renderer_create(g->window);
-    g->chunk_manager = chunk_manager_create(&(ChunkManagerConfig) {
+    g->chunk_config = (ChunkManagerConfig) {
         .create_radius = CREATE_CHUNK_RADIUS,
         .render_radius = RENDER_CHUNK_RADIUS,
         .delete_radius = DELETE_CHUNK_RADIUS,
         .sign_radius = RENDER_SIGN_RADIUS,
-    });
+        .block_store = USE_SECTION_STORE ? BLOCK_STORE_SECTIONS : BLOCK_STORE_MAP,
+        .cache_memory = CHUNK_CACHE_MEMORY,
+        .prefetch_seconds = PREFETCH_SECONDS,
+    };
+    g->chunk_manager = chunk_manager_create(&g->chunk_config);
+    radius_governor_init(&g->governor, &g->chunk_config, MIN_CHUNK_RADIUS, TARGET_FPS);
     g->input_manager = input_manager_create(g->window);
     if(!g->window || !g->renderer || !g->chunk_manager || !g->input_manager) {
         return 0;
@@ -379,6 +415,7 @@ int main(int argc, char **argv)
     // LOCAL VARIABLES //
     reset_model();
     FPS fps = {0, 0, 0};
+    FrameTimes frame_times = {{0}, 0, 0};
     double last_commit = time_get_seconds();
     double last_update = time_get_seconds();
     renderer_generate_sky_buffer(g->renderer);
@@ -397,6 +434,10 @@ int main(int argc, char **argv)
 
     // BEGIN MAIN LOOP //
     double previous = time_get_seconds();
+    float last_x = s->x;
+    float last_z = s->z;
+    float motion_x = 0;
+    float motion_z = 0;
     while (true) {
         // printf("Frame number: %u\n", frames++);
         // WINDOW SIZE, SCALE AND CLEAR CANVAS //
@@ -413,8 +454,20 @@ int main(int argc, char **argv)
             memset(&fps, 0, sizeof(fps));
         }
         update_fps(&fps);
+        #if DEBUG
+        if (fps.frames == 0) {
+            log_stats(&fps, &frame_times);
+        }
+        #endif
         double now = time_get_seconds();
         double dt = now - previous;
+        frame_times_add(&frame_times, (float)(dt * 1000));
+        if (RADIUS_GOVERNOR && radius_governor_update(&g->governor, (float)(dt * 1000),
+            chunk_manager_get_backlog(g->chunk_manager, GOVERNOR_MAX_BACKLOG + 1), now))
+        {
+            radius_governor_apply(&g->governor, &g->chunk_config);
+            chunk_manager_apply_config(g->chunk_manager, &g->chunk_config);
+        }
         dt = MIN(dt, 0.2);
         dt = MAX(dt, 0.0);
         previous = now;
@@ -425,6 +478,14 @@ int main(int argc, char **argv)
         update_ortho_zoom();
         handle_key_movement(me, world_query, dt); // continuous
         handle_commands(world_query);
+        if (dt > 0) {
+            // smoothed over a few frames, a teleport only skews it briefly
+            motion_x += ((s->x - last_x) / dt - motion_x) * MOTION_SMOOTHING;
+            motion_z += ((s->z - last_z) / dt - motion_z) * MOTION_SMOOTHING;
+        }
+        last_x = s->x;
+        last_z = s->z;
+        chunk_manager_set_motion(g->chunk_manager, motion_x, motion_z);
 
         // FLUSH DATABASE //
         if (now - last_commit > COMMIT_INTERVAL) {
@@ -1,72 +1,135 @@
 #include <stdlib.h>
 #include <string.h>
 #include "map.h"
+#include "config.h"
 
-int hash_int(int key) {
-    key = ~key + (key << 15);
-    key = key ^ (key >> 12);
-    key = key + (key << 2);
-    key = key ^ (key >> 4);
-    key = key * 2057;
-    key = key ^ (key >> 16);
-    return key;
-}
+// slots compared at once while probing, see _probe
+#if MAP_SIMD_PROBING && defined(__AVX2__)
+    #include <immintrin.h>
+    #define MAP_GROUP 8
+#elif MAP_SIMD_PROBING && (defined(__SSE2__) || defined(_M_X64))
+    #include <emmintrin.h>
+    #define MAP_GROUP 4
+#else
+    #define MAP_GROUP 1
+#endif
 
-int hash(int x, int y, int z) {
-    x = hash_int(x);
-    y = hash_int(y);
-    z = hash_int(z);
-    return x ^ y ^ z;
-}
+// bytes duplicated by map_copy and copy-on-write, for profiling
+static unsigned long long copied_bytes = 0;
+
+// INTERNAL HELPERS //
+static void _map_own(Map *map);
+static unsigned int _key(int x, int y, int z);
+static unsigned int _hash(unsigned int key);
+static unsigned int _probe(const MapEntry *data, unsigned int mask, unsigned int key);
+static void _remove(MapEntry *data, unsigned int mask, unsigned int index);
+static void _map_resize(Map *map, unsigned int mask);
+static void _migrate(Map *map, unsigned int steps);
+static void _settle(Map *map);
+#if MAP_GROUP > 1
+static int _lowest_bit(unsigned int bits);
+#endif
+// ========
 
 void map_alloc(Map *map, int dx, int dy, int dz, int mask) {
     map->dx = dx;
     map->dy = dy;
     map->dz = dz;
     map->mask = mask;
+    map->min_mask = mask;
     map->size = 0;
     map->data = (MapEntry *)calloc(map->mask + 1, sizeof(MapEntry));
+    map->old_data = NULL;
+    map->old_mask = 0;
+    map->moved = 0;
+    map->refs = NULL;
 }
 
 void map_free(Map *map) {
+    if (map->refs && --(*map->refs) > 0) {
+        map->data = NULL;
+        map->refs = NULL;
+        return;
+    }
+    free(map->refs);
     free(map->data);
+    free(map->old_data);
+    map->data = NULL;
+    map->old_data = NULL;
+    map->refs = NULL;
 }
 
 void map_copy(Map *dst, Map *src) {
+    _settle(src);
     dst->dx = src->dx;
     dst->dy = src->dy;
     dst->dz = src->dz;
     dst->mask = src->mask;
+    dst->min_mask = src->min_mask;
     dst->size = src->size;
     dst->data = (MapEntry *)calloc(dst->mask + 1, sizeof(MapEntry));
+    dst->old_data = NULL;
+    dst->old_mask = 0;
+    dst->moved = 0;
+    dst->refs = NULL;
     memcpy(dst->data, src->data, (dst->mask + 1) * sizeof(MapEntry));
+    copied_bytes += (dst->mask + 1) * sizeof(MapEntry);
 }
 
+// makes dst a read-only view of src's entries; whichever side writes first
+// takes a private copy (see _map_own), the last map_free releases the data.
+// A resize under way is finished first, shared maps only ever have one table.
+void map_share(Map *dst, Map *src) {
+    _settle(src);
+    if (!src->refs) {
+        src->refs = (unsigned int *)malloc(sizeof(unsigned int));
+        *src->refs = 1;
+    }
+    (*src->refs)++;
+    memcpy(dst, src, sizeof(Map));
+}
+
+unsigned long long map_copied_bytes() {
+    return copied_bytes;
+}
+
+// while a resize is under way every call moves MAP_REHASH_STEP slots of
+// the old table over, so no single call pays for the whole rehash
 int map_set(Map *map, int x, int y, int z, int w) {
-    unsigned int index = hash(x, y, z) & map->mask;
-    x -= map->dx;
-    y -= map->dy;
-    z -= map->dz;
-    MapEntry *entry = map->data + index;
-    int overwrite = 0;
-    while (!EMPTY_ENTRY(entry)) {
-        if (entry->e.x == x && entry->e.y == y && entry->e.z == z) {
-            overwrite = 1;
-            break;
+    _map_own(map);
+    if (map->old_data) {
+        _migrate(map, MAP_REHASH_STEP);
+    }
+    unsigned int key = _key(x - map->dx, y - map->dy, z - map->dz);
+    MapEntry *data = map->data;
+    unsigned int mask = map->mask;
+    unsigned int index = _probe(data, mask, key);
+    if (EMPTY_ENTRY(data + index) && map->old_data) {
+        unsigned int old_index = _probe(map->old_data, map->old_mask, key);
+        if (!EMPTY_ENTRY(map->old_data + old_index)) {
+            data = map->old_data; // not moved over yet, edit it in place
+            mask = map->old_mask;
+            index = old_index;
         }
-        index = (index + 1) & map->mask;
-        entry = map->data + index;
     }
-    if (overwrite) {
-        if (entry->e.w != w) {
+    MapEntry *entry = data + index;
+    if (!EMPTY_ENTRY(entry)) {
+        if (entry->e.w == w) {
+            return 0;
+        }
+        if (w) {
             entry->e.w = w;
             return 1;
         }
+        _remove(data, mask, index);
+        map->size--;
+        if (map->size * 8 < map->mask && map->mask > map->min_mask && !map->old_data) {
+            _map_resize(map, map->mask >> 1);
+        }
+        return 1;
     }
     else if (w) {
-        entry->e.x = x;
-        entry->e.y = y;
-        entry->e.z = z;
+        entry->value = key;
         entry->e.w = w;
         map->size++;
         if (map->size * 2 > map->mask) {
@@ -78,37 +141,188 @@ int map_set(Map *map, int x, int y, int z, int w) {
 }
 
 int map_get(Map *map, int x, int y, int z) {
-    unsigned int index = hash(x, y, z) & map->mask;
     x -= map->dx;
     y -= map->dy;
     z -= map->dz;
     if (x < 0 || x > 255) return 0;
     if (y < 0 || y > 255) return 0;
     if (z < 0 || z > 255) return 0;
-    MapEntry *entry = map->data + index;
-    while (!EMPTY_ENTRY(entry)) {
-        if (entry->e.x == x && entry->e.y == y && entry->e.z == z) {
-            return entry->e.w;
-        }
-        index = (index + 1) & map->mask;
-        entry = map->data + index;
+    unsigned int key = _key(x, y, z);
+    MapEntry *entry = map->data + _probe(map->data, map->mask, key);
+    if (EMPTY_ENTRY(entry) && map->old_data) {
+        entry = map->old_data + _probe(map->old_data, map->old_mask, key);
     }
-    return 0;
+    return entry->e.w; // 0 when empty
 }
 
+// starts doubling the table, map_set moves the entries over
 void map_grow(Map *map) {
-    Map new_map;
-    new_map.dx = map->dx;
-    new_map.dy = map->dy;
-    new_map.dz = map->dz;
-    new_map.mask = (map->mask << 1) | 1;
-    new_map.size = 0;
-    new_map.data = (MapEntry *)calloc(new_map.mask + 1, sizeof(MapEntry));
-    MAP_FOR_EACH(map, ex, ey, ez, ew) {
-        map_set(&new_map, ex, ey, ez, ew);
-    } END_MAP_FOR_EACH;
-    free(map->data);
-    map->mask = new_map.mask;
-    map->size = new_map.size;
-    map->data = new_map.data;
+    _map_own(map);
+    _map_resize(map, (map->mask << 1) | 1);
+}
+
+// makes room for size entries up front, so filling the map never grows it,
+// and removals do not shrink it below that either
+void map_reserve(Map *map, unsigned int size) {
+    _map_own(map);
+    unsigned int mask = map->min_mask;
+    while (size * 2 > mask) {
+        mask = (mask << 1) | 1;
+    }
+    map->min_mask = mask;
+    if (mask > map->mask) {
+        _map_resize(map, mask);
+        _settle(map);
+    }
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+// x, y and z as they sit in the low 24 bits of MapEntry.value, w is 0.
+// Coordinates wrap to a byte like the entry fields do.
+static unsigned int _key(int x, int y, int z) {
+    MapEntry entry;
+    entry.e.x = x;
+    entry.e.y = y;
+    entry.e.z = z;
+    entry.e.w = 0;
+    return entry.value;
+}
+static unsigned int _hash(unsigned int key) {
+    key *= 0x9e3779b1u;
+    key ^= key >> 16;
+    return key;
+}
+// slot of the entry with this key, or of the empty slot where linear
+// probing for it stops. Most lookups end at the home slot; past it,
+// MAP_GROUP slots are probed per step with SSE2 or AVX2: the aligned group
+// holding a slot is loaded whole, and the slots in front of it are masked
+// off, so slots are seen in the scalar order.
+static unsigned int _probe(const MapEntry *data, unsigned int mask, unsigned int key) {
+    unsigned int key_mask = _key(0xff, 0xff, 0xff);
+    unsigned int index = _hash(key) & mask;
+    unsigned int value = data[index].value;
+    if (!value || (value & key_mask) == key) {
+        return index;
+    }
+    index = (index + 1) & mask;
+#if MAP_GROUP > 1
+    if (mask + 1 >= MAP_GROUP) {
+        unsigned int group = index & ~(unsigned int)(MAP_GROUP - 1);
+        unsigned int skip = index - group;
+#if MAP_GROUP == 8
+        __m256i keys = _mm256_set1_epi32((int)key);
+        __m256i masks = _mm256_set1_epi32((int)key_mask);
+        __m256i zero = _mm256_setzero_si256();
+#else
+        __m128i keys = _mm_set1_epi32((int)key);
+        __m128i masks = _mm_set1_epi32((int)key_mask);
+        __m128i zero = _mm_setzero_si128();
+#endif
+        while (1) {
+#if MAP_GROUP == 8
+            __m256i values = _mm256_loadu_si256((const __m256i *)(data + group));
+            __m256i stop = _mm256_or_si256(
+                _mm256_cmpeq_epi32(_mm256_and_si256(values, masks), keys),
+                _mm256_cmpeq_epi32(values, zero));
+            unsigned int bits = _mm256_movemask_ps(_mm256_castsi256_ps(stop));
+#else
+            __m128i values = _mm_loadu_si128((const __m128i *)(data + group));
+            __m128i stop = _mm_or_si128(
+                _mm_cmpeq_epi32(_mm_and_si128(values, masks), keys),
+                _mm_cmpeq_epi32(values, zero));
+            unsigned int bits = _mm_movemask_ps(_mm_castsi128_ps(stop));
+#endif
+            bits >>= skip;
+            if (bits) {
+                return group + skip + _lowest_bit(bits);
+            }
+            skip = 0;
+            group = (group + MAP_GROUP) & mask;
+        }
+    }
+#endif
+    while (1) {
+        value = data[index].value;
+        if (!value || (value & key_mask) == key) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+}
+// backward-shift deletion: no tombstones, so probe chains never outlive the
+// entries that created them
+static void _remove(MapEntry *data, unsigned int mask, unsigned int index) {
+    unsigned int key_mask = _key(0xff, 0xff, 0xff);
+    unsigned int hole = index;
+    unsigned int j = (index + 1) & mask;
+    while (!EMPTY_ENTRY(data + j)) {
+        MapEntry *other = data + j;
+        unsigned int home = _hash(other->value & key_mask) & mask;
+        // move the entry back unless its home lies cyclically in (hole, j]
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            data[hole] = *other;
+            hole = j;
+        }
+        j = (j + 1) & mask;
+    }
+    data[hole].value = 0;
+}
+// swaps in an empty table of mask + 1 slots, growing or shrinking the map,
+// and leaves the entries in old_data for map_set to move over
+static void _map_resize(Map *map, unsigned int mask) {
+    _settle(map);
+    map->old_data = map->data;
+    map->old_mask = map->mask;
+    map->moved = 0;
+    map->mask = mask;
+    map->data = (MapEntry *)calloc(map->mask + 1, sizeof(MapEntry));
+}
+// moves entries out of old_data for up to steps slots. Taking an entry out
+// shifts the rest of its run back, never below moved, so a slot is only
+// passed once it is empty and the slots below moved stay empty.
+static void _migrate(Map *map, unsigned int steps) {
+    unsigned int key_mask = _key(0xff, 0xff, 0xff);
+    while (steps-- && map->moved <= map->old_mask) {
+        MapEntry *entry = map->old_data + map->moved;
+        if (EMPTY_ENTRY(entry)) {
+            map->moved++;
+            continue;
+        }
+        MapEntry moving = *entry;
+        _remove(map->old_data, map->old_mask, map->moved);
+        map->data[_probe(map->data, map->mask, moving.value & key_mask)] = moving;
+    }
+    if (map->moved > map->old_mask) {
+        free(map->old_data);
+        map->old_data = NULL;
+    }
+}
+// finishes a resize under way at once
+static void _settle(Map *map) {
+    while (map->old_data) {
+        _migrate(map, map->old_mask + 1);
+    }
+}
+#if MAP_GROUP > 1
+static int _lowest_bit(unsigned int bits) {
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#else
+    int bit = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+#endif
+static void _map_own(Map *map) {
+    if (!map->refs || *map->refs == 1) {
+        return;
+    }
+    (*map->refs)--;
+    Map shared;
+    memcpy(&shared, map, sizeof(Map));
+    map_copy(map, &shared);
 }
@@ -3,9 +3,13 @@
 
 #define EMPTY_ENTRY(entry) ((entry)->value == 0)
 
+// visits the entries of both tables while a resize is under way
 #define MAP_FOR_EACH(map, ex, ey, ez, ew) \
-    for (unsigned int i = 0; i <= map->mask; i++) { \
-        MapEntry *entry = map->data + i; \
+    for (int _table = 0; _table < 2; _table++) { \
+    MapEntry *_data = _table ? map->old_data : map->data; \
+    unsigned int _mask = _table ? map->old_mask : map->mask; \
+    for (unsigned int i = 0; _data && i <= _mask; i++) { \
+        MapEntry *entry = _data + i; \
         if (EMPTY_ENTRY(entry)) { \
             continue; \
         } \
@@ -14,7 +18,7 @@
         int ez = entry->e.z + map->dz; \
         int ew = entry->e.w;
 
-#define END_MAP_FOR_EACH }
+#define END_MAP_FOR_EACH } }
 
 typedef union {
     unsigned int value;
@@ -31,14 +35,24 @@ typedef struct {
     int dy;
     int dz;
     unsigned int mask;
-    unsigned int size;
+    unsigned int min_mask; // removals shrink the table down to its allocated or reserved size
+    unsigned int size; // entries in both tables
     MapEntry *data;
+    // table a resize is still moving entries out of, NULL when there is none.
+    // Each map_set moves a few, its slots below moved are already empty.
+    MapEntry *old_data;
+    unsigned int old_mask;
+    unsigned int moved;
+    unsigned int *refs; // shared with map_share when set, main thread only
 } Map;
 
 void map_alloc(Map *map, int dx, int dy, int dz, int mask);
 void map_free(Map *map);
 void map_copy(Map *dst, Map *src);
+void map_share(Map *dst, Map *src);
+unsigned long long map_copied_bytes();
 void map_grow(Map *map);
+void map_reserve(Map *map, unsigned int size);
 int map_set(Map *map, int x, int y, int z, int w);
 int map_get(Map *map, int x, int y, int z);
 
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "mesher.h"
@@ -8,25 +9,133 @@
 #include "cube.h"
 
 #define XZ_SIZE (CHUNK_SIZE * 3 + 2)
-#define XZ_LO (CHUNK_SIZE)
-#define XZ_HI (CHUNK_SIZE * 2 + 1)
 #define Y_SIZE 258
 #define XYZ(x, y, z) ((y) * XZ_SIZE * XZ_SIZE + (x) * XZ_SIZE + (z))
 #define XZ(x, z) ((x) * XZ_SIZE + (z))
+#define COLUMN_WORDS 4 // 64 bit words of a column bitmask, bit y for world y
+#define COLUMN_SIDE (CHUNK_SIZE + 2)
+#define COLUMN(x, z) (((x) + 1) * COLUMN_SIDE + (z) + 1) // chunk x, z from -1 to CHUNK_SIZE
+#define TYPE(x, y, z) ((((x) * CHUNK_SIZE) + (z)) * 256 + (y)) // chunk x, z
+#define SHADE(x, y, z) (COLUMN(x, z) * Y_SIZE + (y)) // chunk x, z, y as in opaque
+#define MERGE_SLICES (CHUNK_SIZE * 4 + Y_SIZE * 2) // slices of all six face directions
+#define SIGN_CACHE_SIZE 256 // signs whose glyph quads a scratch keeps, by face and text
 
-// INTERNAL HELPERS //
-static void light_fill(
-    char *opaque, char *light,
-    int x, int y, int z, int w, int force);
+// an exposed face with the same ao and light on all four corners, such
+// faces can merge with their neighbours without changing how they look
+typedef struct {
+    int x, y, z; // in the chunk
+    int face;
+    int tile;
+    float ao;
+    float light;
+} MergeFace;
+
+typedef struct {
+    int count;
+    int capacity;
+    MergeFace *data;
+} MergeFaceList;
+
+typedef uint64_t ColumnMask[COLUMN_WORDS];
+
+// the glyphs of one sign at 0, 0, 0, wrapping the text is most of the work
+typedef struct {
+    int face; // -1 for an empty entry
+    char text[MAX_SIGN_LENGTH];
+    int faces;
+    GLfloat *data;
+} SignQuads;
+
+// Buffers are zero, and mask all -1, between calls. Only the y ranges a
+// call wrote to are cleared afterwards, most of a chunk is sky.
+struct MesherScratch {
+    char *opaque;
+    char *light;
+    int opaque_miny, opaque_maxy; // y range of opaque written to
+    int light_miny, light_maxy; // y range of light written to
+    ColumnMask *solid; // opaque blocks of the chunk and a one block border
+    ColumnMask *present; // blocks of the chunk that get a mesh
+    ColumnMask *plants;
+    unsigned char *types; // block of the chunk, valid where present is set
+    unsigned char *shade; // eighths of shade from above, see _fill_shades
+    void *vertices; // mesh being built, handed to the output, NULL between calls
+    size_t vertices_capacity; // bytes, the last call's size starts the next buffer
+    MergeFaceList merge;
+    int *order;
+    int order_capacity;
+    int *mask;
+    SignQuads *signs; // SIGN_CACHE_SIZE entries, see _sign_quads
+};
 
+// INTERNAL HELPERS //
 static void occlusion(
     char neighbors[27], char lights[27], float shades[27],
     float ao[6][4], float light[6][4]);
 
 static int _gen_sign_buffer(
     GLfloat *data, float x, float y, float z, int face, const char *text);
+static void _gen_sign_mesh(MesherScratch *scratch, MesherOutput *output, SignList *signs);
+static const SignQuads *_sign_quads(MesherScratch *scratch, int face, const char *text);
+
+static int _is_uniform(const float values[4]);
+static void _merge_face_add(
+    MergeFaceList *list, int x, int y, int z, int face, int w, float ao, float light);
+static int _same_merge_face(const MergeFace *a, const MergeFace *b);
+static int _merge_faces(MesherScratch *scratch, int px, int pz, int packed, void *data);
+static void _clear_y_range(char *buffer, int miny, int maxy);
+static void _column_faces(MesherScratch *scratch, int x, int z, int word, uint64_t faces[6]);
+static void _fill_shades(MesherScratch *scratch, int miny, int maxy);
+static void *_reserve_faces(MesherScratch *scratch, size_t face_bytes, int faces);
+static int _lowest_bit(uint64_t bits);
+static int _highest_bit(uint64_t bits);
 // ========
 
+MesherScratch *mesher_scratch_create() {
+    MesherScratch *scratch = (MesherScratch *)calloc(1, sizeof(MesherScratch));
+    if (!scratch) {
+        return NULL;
+    }
+    scratch->opaque = (char *)calloc(XZ_SIZE * XZ_SIZE * Y_SIZE, sizeof(char));
+    scratch->light = (char *)calloc(XZ_SIZE * XZ_SIZE * Y_SIZE, sizeof(char));
+    scratch->opaque_miny = Y_SIZE;
+    scratch->opaque_maxy = -1;
+    scratch->light_miny = Y_SIZE;
+    scratch->light_maxy = -1;
+    scratch->solid = (ColumnMask *)calloc(COLUMN_SIDE * COLUMN_SIDE, sizeof(ColumnMask));
+    scratch->present = (ColumnMask *)calloc(COLUMN_SIDE * COLUMN_SIDE, sizeof(ColumnMask));
+    scratch->plants = (ColumnMask *)calloc(COLUMN_SIDE * COLUMN_SIDE, sizeof(ColumnMask));
+    scratch->types = (unsigned char *)malloc(CHUNK_SIZE * CHUNK_SIZE * 256);
+    scratch->shade = (unsigned char *)malloc(COLUMN_SIDE * COLUMN_SIDE * Y_SIZE);
+    scratch->mask = (int *)malloc(sizeof(int) * CHUNK_SIZE * Y_SIZE);
+    for (int i = 0; i < CHUNK_SIZE * Y_SIZE; i++) {
+        scratch->mask[i] = -1;
+    }
+    scratch->signs = (SignQuads *)calloc(SIGN_CACHE_SIZE, sizeof(SignQuads));
+    for (int i = 0; i < SIGN_CACHE_SIZE; i++) {
+        scratch->signs[i].face = -1;
+    }
+    return scratch;
+}
+void mesher_scratch_destroy(MesherScratch *scratch) {
+    if (scratch) {
+        free(scratch->opaque);
+        free(scratch->light);
+        free(scratch->solid);
+        free(scratch->present);
+        free(scratch->plants);
+        free(scratch->types);
+        free(scratch->shade);
+        free(scratch->vertices);
+        free(scratch->merge.data);
+        free(scratch->order);
+        free(scratch->mask);
+        for (int i = 0; i < SIGN_CACHE_SIZE; i++) {
+            free(scratch->signs[i].data);
+        }
+        free(scratch->signs);
+        free(scratch);
+    }
+}
 void mesher_free_output_data(MesherOutput *output) {
     if(output) {
         free(output->data);
@@ -48,9 +157,25 @@ MesherOutput *mesher_compute_chunk(MesherInput *input) {
     if (!output) {
         return NULL;
     }
-    char *opaque = (char *)calloc(XZ_SIZE * XZ_SIZE * Y_SIZE, sizeof(char));
-    char *light = (char *)calloc(XZ_SIZE * XZ_SIZE * Y_SIZE, sizeof(char));
-    char *highest = (char *)calloc(XZ_SIZE * XZ_SIZE, sizeof(char));
+    // without a scratch from the caller, one lives for this call only
+    MesherScratch *scratch = input->scratch;
+    if (!scratch) {
+        scratch = mesher_scratch_create();
+    }
+    char *opaque = scratch->opaque;
+    char *light = scratch->light;
+    unsigned int sections = input->sections;
+
+    // world y of the blocks to mesh, and of the blocks their faces read:
+    // one below and above, and shades from up to 8 above
+    int mesh_miny = 256;
+    int mesh_maxy = -1;
+    if (sections) {
+        mesh_miny = _lowest_bit(sections) * MESH_SECTION_HEIGHT;
+        mesh_maxy = (_highest_bit(sections) + 1) * MESH_SECTION_HEIGHT - 1;
+    }
+    int read_miny = mesh_miny - 1;
+    int read_maxy = mesh_maxy + 8;
 
     int ox = input->p * CHUNK_SIZE - CHUNK_SIZE - 1;
     int oy = -1;
@@ -72,15 +197,18 @@ MesherOutput *mesher_compute_chunk(MesherInput *input) {
     // populate opaque array
     for (int a = 0; a < 3; a++) {
         for (int b = 0; b < 3; b++) {
-            Map *map = input->block[a][b];
-            if (!map) {
+            BlockStore *blocks = input->block[a][b];
+            if (!blocks) {
                 continue;
             }
-            MAP_FOR_EACH(map, ex, ey, ez, ew) {
+            BLOCK_STORE_FOR_EACH_IN_RANGE(blocks, read_miny, read_maxy, ex, ey, ez, ew) {
                 int x = ex - ox;
                 int y = ey - oy;
                 int z = ez - oz;
                 int w = ew;
+                if (ey < read_miny || ey > read_maxy) {
+                    continue;
+                }
                 // TODO: this should be unnecessary
                 if (x < 0 || y < 0 || z < 0) {
                     continue;
@@ -90,14 +218,13 @@ MesherOutput *mesher_compute_chunk(MesherInput *input) {
                 }
                 // END TODO
                 opaque[XYZ(x, y, z)] = !is_transparent(w);
-                if (opaque[XYZ(x, y, z)]) {
-                    highest[XZ(x, z)] = MAX(highest[XZ(x, z)], y);
-                }
-            } END_MAP_FOR_EACH;
+                scratch->opaque_miny = MIN(scratch->opaque_miny, y);
+                scratch->opaque_maxy = MAX(scratch->opaque_maxy, y);
+            } END_BLOCK_STORE_FOR_EACH;
         }
     }
 
-    // flood fill light intensities
+    // populate light array, the levels are already spread
     if (has_light) {
         for (int a = 0; a < 3; a++) {
             for (int b = 0; b < 3; b++) {
@@ -109,170 +236,255 @@ MesherOutput *mesher_compute_chunk(MesherInput *input) {
                     int x = ex - ox;
                     int y = ey - oy;
                     int z = ez - oz;
-                    light_fill(opaque, light, x, y, z, ew, 1);
+                    if (ey < read_miny || ey > read_maxy) {
+                        continue;
+                    }
+                    if (x < 0 || y < 0 || z < 0) {
+                        continue;
+                    }
+                    if (x >= XZ_SIZE || y >= Y_SIZE || z >= XZ_SIZE) {
+                        continue;
+                    }
+                    light[XYZ(x, y, z)] = ew;
+                    scratch->light_miny = MIN(scratch->light_miny, y);
+                    scratch->light_maxy = MAX(scratch->light_maxy, y);
                 } END_MAP_FOR_EACH;
             }
         }
     }
 
-    Map *map = input->block[1][1];
-
-    // count exposed faces
-    int miny = 256;
-    int maxy = 0;
-    int faces = 0;
-    MAP_FOR_EACH(map, ex, ey, ez, ew) {
-        if (ew <= 0) {
+    // column bitmasks: opaque blocks of the chunk and its border, read row
+    // by row from the opaque array, and the chunk's own blocks
+    int cx = input->p * CHUNK_SIZE;
+    int cz = input->q * CHUNK_SIZE;
+    int column_miny = MAX(scratch->opaque_miny + oy, 0);
+    int column_maxy = MIN(scratch->opaque_maxy + oy, 255);
+    for (int ey = column_miny; ey <= column_maxy; ey++) {
+        for (int lx = -1; lx <= CHUNK_SIZE; lx++) {
+            const char *row = opaque + XYZ(cx + lx - ox, ey - oy, cz - 1 - oz);
+            ColumnMask *solid = scratch->solid + COLUMN(lx, -1);
+            for (int lz = 0; lz < COLUMN_SIDE; lz++) {
+                solid[lz][ey >> 6] |= (uint64_t)row[lz] << (ey & 63); // opaque is 0 or 1
+            }
+        }
+    }
+    int present_miny = 256;
+    int present_maxy = -1;
+    unsigned int present_sections = 0;
+    BlockStore *blocks = input->block[1][1];
+    BLOCK_STORE_FOR_EACH_IN_RANGE(blocks, mesh_miny, mesh_maxy, ex, ey, ez, ew) {
+        int lx = ex - cx;
+        int lz = ez - cz;
+        if (ew <= 0 || lx < 0 || lz < 0 || lx >= CHUNK_SIZE || lz >= CHUNK_SIZE) {
             continue;
         }
-        int x = ex - ox;
-        int y = ey - oy;
-        int z = ez - oz;
-        int f1 = !opaque[XYZ(x - 1, y, z)];
-        int f2 = !opaque[XYZ(x + 1, y, z)];
-        int f3 = !opaque[XYZ(x, y + 1, z)];
-        int f4 = !opaque[XYZ(x, y - 1, z)] && (ey > 0);
-        int f5 = !opaque[XYZ(x, y, z - 1)];
-        int f6 = !opaque[XYZ(x, y, z + 1)];
-        int total = f1 + f2 + f3 + f4 + f5 + f6;
-        if (total == 0) {
+        unsigned int section = 1u << (ey / MESH_SECTION_HEIGHT);
+        if (!(sections & section)) {
             continue;
         }
+        present_sections |= section;
+        present_miny = MIN(present_miny, ey);
+        present_maxy = MAX(present_maxy, ey);
+        uint64_t bit = (uint64_t)1 << (ey & 63);
+        scratch->present[COLUMN(lx, lz)][ey >> 6] |= bit;
         if (is_plant(ew)) {
-            total = 4;
+            scratch->plants[COLUMN(lx, lz)][ey >> 6] |= bit;
         }
-        miny = MIN(miny, ey);
-        maxy = MAX(maxy, ey);
-        faces += total;
-    } END_MAP_FOR_EACH;
+        scratch->types[TYPE(lx, ey, lz)] = ew;
+    } END_BLOCK_STORE_FOR_EACH;
 
-    // generate geometry
-    GLfloat *data = malloc_faces(10, faces);
-    int offset = 0;
-    MAP_FOR_EACH(map, ex, ey, ez, ew) {
-        if (ew <= 0) {
-            continue;
+    // no block is exposed below the first y some column leaves open, most
+    // chunks are solid up to their lowest valley
+    int open_y = 0;
+    while (open_y < 256) {
+        uint64_t bit = (uint64_t)1 << (open_y & 63);
+        int i = 0;
+        while (i < COLUMN_SIDE * COLUMN_SIDE && (scratch->solid[i][open_y >> 6] & bit)) {
+            i++;
         }
-        int x = ex - ox;
-        int y = ey - oy;
-        int z = ez - oz;
-        int f1 = !opaque[XYZ(x - 1, y, z)];
-        int f2 = !opaque[XYZ(x + 1, y, z)];
-        int f3 = !opaque[XYZ(x, y + 1, z)];
-        int f4 = !opaque[XYZ(x, y - 1, z)] && (ey > 0);
-        int f5 = !opaque[XYZ(x, y, z - 1)];
-        int f6 = !opaque[XYZ(x, y, z + 1)];
-        int total = f1 + f2 + f3 + f4 + f5 + f6;
-        if (total == 0) {
+        if (i < COLUMN_SIDE * COLUMN_SIDE) {
+            break;
+        }
+        open_y++;
+    }
+    present_miny = MAX(present_miny, open_y - 1);
+    if (present_miny <= present_maxy) {
+        _fill_shades(scratch, present_miny, present_maxy);
+    }
+
+    // generate geometry in one pass per section, into a buffer that grows
+    // as needed, merged faces are collected and emitted at the section's end
+    int miny = 256;
+    int maxy = 0;
+    size_t face_bytes = 4 * MESHER_VERTEX_BYTES(input->packed);
+    int offset = 0; // faces written
+    MergeFaceList *merge = &scratch->merge;
+    for (int section = 0; section < MESHER_SECTIONS; section++) {
+        int first = offset;
+        if (!(present_sections & (1u << section))) {
+            output->section_faces[section] = 0;
             continue;
         }
-        char neighbors[27] = {0};
-        char lights[27] = {0};
-        float shades[27] = {0};
-        int index = 0;
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dz = -1; dz <= 1; dz++) {
-                    neighbors[index] = opaque[XYZ(x + dx, y + dy, z + dz)];
-                    lights[index] = light[XYZ(x + dx, y + dy, z + dz)];
-                    shades[index] = 0;
-                    if (y + dy <= highest[XZ(x + dx, z + dz)]) {
-                        for (int oy = 0; oy < 8; oy++) {
-                            if (opaque[XYZ(x + dx, y + dy + oy, z + dz)]) {
-                                shades[index] = 1.0 - oy * 0.125;
-                                break;
+        int word = section * MESH_SECTION_HEIGHT / 64;
+        uint64_t bits = (~(uint64_t)0 >> (64 - MESH_SECTION_HEIGHT)) <<
+            (section * MESH_SECTION_HEIGHT % 64);
+        for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+            for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+                uint64_t exposed[6];
+                _column_faces(scratch, lx, lz, word, exposed);
+                uint64_t any = (exposed[0] | exposed[1] | exposed[2] |
+                    exposed[3] | exposed[4] | exposed[5]) & bits;
+                if (any) {
+                    miny = MIN(miny, word * 64 + _lowest_bit(any));
+                    maxy = MAX(maxy, word * 64 + _highest_bit(any));
+                }
+                while (any) {
+                    int bit = _lowest_bit(any);
+                    any &= any - 1;
+                    int ex = cx + lx;
+                    int ey = word * 64 + bit;
+                    int ez = cz + lz;
+                    int ew = scratch->types[TYPE(lx, ey, lz)];
+                    int x = ex - ox;
+                    int y = ey - oy;
+                    int z = ez - oz;
+                    int f1 = (exposed[0] >> bit) & 1;
+                    int f2 = (exposed[1] >> bit) & 1;
+                    int f3 = (exposed[2] >> bit) & 1;
+                    int f4 = (exposed[3] >> bit) & 1;
+                    int f5 = (exposed[4] >> bit) & 1;
+                    int f6 = (exposed[5] >> bit) & 1;
+                    int total = f1 + f2 + f3 + f4 + f5 + f6;
+                    char neighbors[27] = {0};
+                    char lights[27] = {0};
+                    float shades[27] = {0};
+                    int index = 0;
+                    for (int dx = -1; dx <= 1; dx++) {
+                        for (int dy = -1; dy <= 1; dy++) {
+                            for (int dz = -1; dz <= 1; dz++) {
+                                neighbors[index] = opaque[XYZ(x + dx, y + dy, z + dz)];
+                                lights[index] = light[XYZ(x + dx, y + dy, z + dz)];
+                                shades[index] = scratch->shade[
+                                    SHADE(lx + dx, y + dy, lz + dz)] * 0.125f;
+                                index++;
                             }
                         }
                     }
-                    index++;
-                }
-            }
-        }
-        float ao[6][4];
-        float light[6][4];
-        occlusion(neighbors, lights, shades, ao, light);
-        if (is_plant(ew)) {
-            total = 4;
-            float min_ao = 1;
-            float max_light = 0;
-            for (int a = 0; a < 6; a++) {
-                for (int b = 0; b < 4; b++) {
-                    min_ao = MIN(min_ao, ao[a][b]);
-                    max_light = MAX(max_light, light[a][b]);
+                    float ao[6][4];
+                    float light[6][4];
+                    occlusion(neighbors, lights, shades, ao, light);
+                    void *data = _reserve_faces(scratch, face_bytes, offset + 6);
+                    GLfloat *floats = (GLfloat *)data;
+                    GLushort *packed = (GLushort *)data;
+                    if (is_plant(ew)) {
+                        total = 4;
+                        float min_ao = 1;
+                        float max_light = 0;
+                        for (int a = 0; a < 6; a++) {
+                            for (int b = 0; b < 4; b++) {
+                                min_ao = MIN(min_ao, ao[a][b]);
+                                max_light = MAX(max_light, light[a][b]);
+                            }
+                        }
+                        float rotation = simplex2(ex, ez, 4, 0.5, 2) * 360;
+                        if (input->packed) {
+                            make_plant_packed(
+                                packed + offset * 4 * CUBE_PACKED_COMPONENTS,
+                                min_ao, max_light, lx, ey, lz, ew, rotation);
+                        }
+                        else {
+                            make_plant(
+                                floats + offset * 40, min_ao, max_light,
+                                ex, ey, ez, 0.5, ew, rotation);
+                        }
+                    }
+                    else {
+                        int f[6] = {f1, f2, f3, f4, f5, f6};
+                        if (input->greedy && !is_transparent(ew)) {
+                            for (int i = 0; i < 6; i++) {
+                                if (f[i] && _is_uniform(ao[i]) && _is_uniform(light[i])) {
+                                    _merge_face_add(merge,
+                                        lx, ey, lz, i, ew, ao[i][0], light[i][0]);
+                                    f[i] = 0;
+                                    total--;
+                                }
+                            }
+                        }
+                        if (input->packed) {
+                            make_cube_packed(
+                                packed + offset * 4 * CUBE_PACKED_COMPONENTS, ao, light,
+                                f[0], f[1], f[2], f[3], f[4], f[5],
+                                lx, ey, lz, ew);
+                        }
+                        else {
+                            make_cube(
+                                floats + offset * 40, ao, light,
+                                f[0], f[1], f[2], f[3], f[4], f[5],
+                                ex, ey, ez, 0.5, ew);
+                        }
+                    }
+                    offset += total;
                 }
             }
-            float rotation = simplex2(ex, ez, 4, 0.5, 2) * 360;
-            make_plant(
-                data + offset, min_ao, max_light,
-                ex, ey, ez, 0.5, ew, rotation);
         }
-        else {
-            make_cube(
-                data + offset, ao, light,
-                f1, f2, f3, f4, f5, f6,
-                ex, ey, ez, 0.5, ew);
+        if (input->greedy) {
+            // merging never makes more faces than it was given
+            void *data = _reserve_faces(scratch, face_bytes, offset + merge->count);
+            offset += _merge_faces(scratch, cx, cz, input->packed,
+                (char *)data + offset * face_bytes);
+            merge->count = 0;
         }
-        offset += total * 60;
-    } END_MAP_FOR_EACH;
+        output->section_faces[section] = offset - first;
+    }
+    // the output takes the buffer over, trimmed in place to its size
+    void *data = realloc(_reserve_faces(scratch, face_bytes, 1), face_bytes * MAX(offset, 1));
+    scratch->vertices = NULL;
 
-    free(opaque);
-    free(light);
-    free(highest);
+    output->sign_mesh = 0;
+    output->sign_data = NULL;
+    output->sign_faces = 0;
+    if (input->signs) {
+        _gen_sign_mesh(scratch, output, input->signs);
+    }
+
+    _clear_y_range(opaque, scratch->opaque_miny, scratch->opaque_maxy);
+    _clear_y_range(light, scratch->light_miny, scratch->light_maxy);
+    memset(scratch->solid, 0, sizeof(ColumnMask) * COLUMN_SIDE * COLUMN_SIDE);
+    memset(scratch->present, 0, sizeof(ColumnMask) * COLUMN_SIDE * COLUMN_SIDE);
+    memset(scratch->plants, 0, sizeof(ColumnMask) * COLUMN_SIDE * COLUMN_SIDE);
+    scratch->opaque_miny = Y_SIZE;
+    scratch->opaque_maxy = -1;
+    scratch->light_miny = Y_SIZE;
+    scratch->light_maxy = -1;
+    if (!input->scratch) {
+        mesher_scratch_destroy(scratch);
+    }
     output->data = data;
-    output->faces = faces;
+    output->packed = input->packed;
+    output->p = input->p;
+    output->q = input->q;
+    output->faces = offset;
+    output->sections = sections;
     output->miny = miny;
     output->maxy = maxy;
     return output;
 }
-void mesher_generate_sign_mesh(MesherOutput *mesher_output, SignList *signs) {
-    // first pass - count characters
-    int max_faces = 0;
-    for (int i = 0; i < signs->size; i++)
-    {
-        Sign *e = signs->data + i;
-        max_faces += strlen(e->text);
+// sections with a block whose faces read a block from miny to maxy: the
+// blocks from 8 below to 1 above, see mesher_compute_chunk
+unsigned int mesher_sections_reading(int miny, int maxy) {
+    miny = MAX(miny - 8, 0);
+    maxy = MIN(maxy + 1, 255);
+    if (miny > maxy) {
+        return 0;
     }
-    // second pass - generate geometry
-    GLfloat *data = malloc_faces(5, max_faces);
-    int faces = 0;
-    for (int i = 0; i < signs->size; i++)
-    {
-        Sign *e = signs->data + i;
-        faces += _gen_sign_buffer(
-            data + faces * 30, e->x, e->y, e->z, e->face, e->text);
+    unsigned int sections = 0;
+    for (int section = miny / MESH_SECTION_HEIGHT; section <= maxy / MESH_SECTION_HEIGHT; section++) {
+        sections |= 1u << section;
     }
-    mesher_output->sign_data = data;
-    mesher_output->sign_faces = faces;
+    return sections;
 }
 
 // INTERNAL HELPERS IMPLEMENTATIONS //
-static void light_fill(
-    char *opaque, char *light,
-    int x, int y, int z, int w, int force)
-{
-    if (x + w < XZ_LO || z + w < XZ_LO) {
-        return;
-    }
-    if (x - w > XZ_HI || z - w > XZ_HI) {
-        return;
-    }
-    if (y < 0 || y >= Y_SIZE) {
-        return;
-    }
-    if (light[XYZ(x, y, z)] >= w) {
-        return;
-    }
-    if (!force && opaque[XYZ(x, y, z)]) {
-        return;
-    }
-    light[XYZ(x, y, z)] = w--;
-    light_fill(opaque, light, x - 1, y, z, w, 0);
-    light_fill(opaque, light, x + 1, y, z, w, 0);
-    light_fill(opaque, light, x, y - 1, z, w, 0);
-    light_fill(opaque, light, x, y + 1, z, w, 0);
-    light_fill(opaque, light, x, y, z - 1, w, 0);
-    light_fill(opaque, light, x, y, z + 1, w, 0);
-}
 static void occlusion(
     char neighbors[27], char lights[27], float shades[27],
     float ao[6][4], float light[6][4])
@@ -383,4 +595,290 @@ static int _gen_sign_buffer(
         }
     }
     return count;
-}
\ No newline at end of file
+}
+static void _gen_sign_mesh(MesherScratch *scratch, MesherOutput *output, SignList *signs) {
+    // first pass - count characters
+    int max_faces = 0;
+    for (int i = 0; i < signs->size; i++)
+    {
+        Sign *e = signs->data + i;
+        max_faces += strlen(e->text);
+    }
+    // second pass - move the cached glyphs of every sign into place
+    GLfloat *data = malloc_faces(5, max_faces);
+    int faces = 0;
+    for (int i = 0; i < signs->size; i++)
+    {
+        Sign *e = signs->data + i;
+        const SignQuads *quads = _sign_quads(scratch, e->face, e->text);
+        GLfloat *d = data + faces * 30;
+        memcpy(d, quads->data, sizeof(GLfloat) * 30 * quads->faces);
+        for (int j = 0; j < quads->faces * 6; j++) {
+            d[j * 5 + 0] += e->x;
+            d[j * 5 + 1] += e->y;
+            d[j * 5 + 2] += e->z;
+        }
+        faces += quads->faces;
+    }
+    output->sign_mesh = 1;
+    output->sign_data = data;
+    output->sign_faces = faces;
+}
+// the glyphs of a sign with this face and text, generated when the cache
+// entry they hash to holds another sign
+static const SignQuads *_sign_quads(MesherScratch *scratch, int face, const char *text) {
+    unsigned int hash = 2166136261u ^ (unsigned int)face; // FNV-1a
+    for (const char *c = text; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    SignQuads *quads = scratch->signs + hash % SIGN_CACHE_SIZE;
+    if (quads->face == face && !strcmp(quads->text, text)) {
+        return quads;
+    }
+    free(quads->data);
+    quads->data = malloc_faces(5, strlen(text));
+    quads->faces = _gen_sign_buffer(quads->data, 0, 0, 0, face, text);
+    quads->face = face;
+    strncpy(quads->text, text, MAX_SIGN_LENGTH);
+    quads->text[MAX_SIGN_LENGTH - 1] = '\0';
+    return quads;
+}
+static int _is_uniform(const float values[4]) {
+    return values[0] == values[1] && values[0] == values[2] && values[0] == values[3];
+}
+static void _merge_face_add(
+    MergeFaceList *list, int x, int y, int z, int face, int w, float ao, float light)
+{
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 4096;
+        list->data = (MergeFace *)realloc(list->data, sizeof(MergeFace) * list->capacity);
+    }
+    MergeFace *e = list->data + list->count++;
+    e->x = x;
+    e->y = y;
+    e->z = z;
+    e->face = face;
+    e->tile = blocks[w][face];
+    e->ao = ao;
+    e->light = light;
+}
+static int _same_merge_face(const MergeFace *a, const MergeFace *b) {
+    return a->tile == b->tile && a->ao == b->ao && a->light == b->light;
+}
+// Sorts the faces into slices, one plane per face direction and depth, and
+// covers each slice greedily: a rectangle grows along u as far as the faces
+// match, then along v while whole rows match. Returns the faces written.
+static int _merge_faces(MesherScratch *scratch, int px, int pz, int packed, void *data) {
+    MergeFaceList *list = &scratch->merge;
+    // the axis a face looks along, and the u and v axes of its plane
+    static const int normal_axis[6] = {0, 0, 1, 1, 2, 2};
+    static const int u_axis[6] = {2, 2, 0, 0, 0, 0};
+    static const int v_axis[6] = {1, 1, 2, 2, 1, 1};
+    static const int axis_size[3] = {CHUNK_SIZE, Y_SIZE, CHUNK_SIZE};
+    if (!list->count) {
+        return 0;
+    }
+    int first[6];
+    int start[MERGE_SLICES + 1] = {0};
+    for (int i = 0, slice = 0; i < 6; i++) {
+        first[i] = slice;
+        slice += axis_size[normal_axis[i]];
+    }
+    for (int i = 0; i < list->count; i++) {
+        MergeFace *e = list->data + i;
+        int position[3] = {e->x, e->y, e->z};
+        start[first[e->face] + position[normal_axis[e->face]] + 1]++;
+    }
+    for (int i = 0; i < MERGE_SLICES; i++) {
+        start[i + 1] += start[i];
+    }
+    if (scratch->order_capacity < list->count) {
+        scratch->order_capacity = list->capacity;
+        free(scratch->order);
+        scratch->order = (int *)malloc(sizeof(int) * scratch->order_capacity);
+    }
+    int *order = scratch->order;
+    int *mask = scratch->mask; // every entry set below is taken by a rectangle
+    int next[MERGE_SLICES];
+    memcpy(next, start, sizeof(next));
+    for (int i = 0; i < list->count; i++) {
+        MergeFace *e = list->data + i;
+        int position[3] = {e->x, e->y, e->z};
+        order[next[first[e->face] + position[normal_axis[e->face]]]++] = i;
+    }
+
+    int count = 0;
+    for (int face = 0; face < 6; face++) {
+        int ua = u_axis[face];
+        int va = v_axis[face];
+        int width = axis_size[ua];
+        for (int slice = first[face]; slice < first[face] + axis_size[normal_axis[face]]; slice++) {
+            if (start[slice] == start[slice + 1]) {
+                continue;
+            }
+            int umin = width, umax = -1, vmin = Y_SIZE, vmax = -1;
+            for (int k = start[slice]; k < start[slice + 1]; k++) {
+                MergeFace *e = list->data + order[k];
+                int position[3] = {e->x, e->y, e->z};
+                int u = position[ua];
+                int v = position[va];
+                mask[v * width + u] = order[k];
+                umin = MIN(umin, u);
+                umax = MAX(umax, u);
+                vmin = MIN(vmin, v);
+                vmax = MAX(vmax, v);
+            }
+            for (int v = vmin; v <= vmax; v++) {
+                for (int u = umin; u <= umax; u++) {
+                    int m = mask[v * width + u];
+                    if (m < 0) {
+                        continue;
+                    }
+                    MergeFace *e = list->data + m;
+                    int du = 1;
+                    while (u + du <= umax && mask[v * width + u + du] >= 0 &&
+                        _same_merge_face(e, list->data + mask[v * width + u + du]))
+                    {
+                        du++;
+                    }
+                    int dv = 1;
+                    for (; v + dv <= vmax; dv++) {
+                        int row = (v + dv) * width;
+                        int k = 0;
+                        while (k < du && mask[row + u + k] >= 0 &&
+                            _same_merge_face(e, list->data + mask[row + u + k]))
+                        {
+                            k++;
+                        }
+                        if (k < du) {
+                            break;
+                        }
+                    }
+                    for (int b = 0; b < dv; b++) {
+                        for (int a = 0; a < du; a++) {
+                            mask[(v + b) * width + u + a] = -1;
+                        }
+                    }
+                    if (packed) {
+                        int corner[3] = {e->x, e->y, e->z};
+                        int size[3] = {1, 1, 1};
+                        corner[ua] = u;
+                        corner[va] = v;
+                        size[ua] = du;
+                        size[va] = dv;
+                        make_cube_face_span_packed(
+                            (GLushort *)data + count * 4 * CUBE_PACKED_COMPONENTS,
+                            e->ao, e->light, face, e->tile,
+                            corner[0], corner[1], corner[2], size[0], size[1], size[2]);
+                    }
+                    else {
+                        float center[3] = {e->x, e->y, e->z};
+                        float size[3] = {1, 1, 1};
+                        center[ua] = u + (du - 1) / 2.0f;
+                        center[va] = v + (dv - 1) / 2.0f;
+                        size[ua] = du;
+                        size[va] = dv;
+                        make_cube_face_span(
+                            (GLfloat *)data + count * 40, e->ao, e->light, face, e->tile,
+                            px + center[0], center[1], pz + center[2],
+                            size[0], size[1], size[2]);
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+// bit y % 64 of faces[i] is set when face i of the block at y, in the
+// given word of the column, is exposed. Faces are in make_cube order: left,
+// right, top, bottom, front, back. Bottom faces at y = 0 are never seen.
+static void _column_faces(MesherScratch *scratch, int x, int z, int word, uint64_t faces[6]) {
+    const uint64_t *solid = scratch->solid[COLUMN(x, z)];
+    uint64_t present = scratch->present[COLUMN(x, z)][word];
+    uint64_t above = solid[word] >> 1;
+    uint64_t below = solid[word] << 1;
+    if (word + 1 < COLUMN_WORDS) {
+        above |= solid[word + 1] << 63;
+    }
+    below |= word ? solid[word - 1] >> 63 : 1;
+    faces[0] = present & ~scratch->solid[COLUMN(x - 1, z)][word];
+    faces[1] = present & ~scratch->solid[COLUMN(x + 1, z)][word];
+    faces[2] = present & ~above;
+    faces[3] = present & ~below;
+    faces[4] = present & ~scratch->solid[COLUMN(x, z - 1)][word];
+    faces[5] = present & ~scratch->solid[COLUMN(x, z + 1)][word];
+}
+static int _lowest_bit(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int bit = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+static int _highest_bit(uint64_t bits) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(bits);
+#else
+    int bit = 0;
+    while (bits >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+// A block is shaded by the nearest opaque block at most 7 above it, or
+// itself: the shade is 8 - the distance in eighths, 0 without one. Filled
+// per column of the chunk and its border from the solid masks, for the
+// blocks from miny to maxy and the ones next to them, so a lookup is all
+// occlusion() needs per neighbor.
+static void _fill_shades(MesherScratch *scratch, int miny, int maxy) {
+    int top = MIN(maxy + 1 + 7, 255);
+    for (int i = 0; i < COLUMN_SIDE * COLUMN_SIDE; i++) {
+        const uint64_t *solid = scratch->solid[i];
+        unsigned char *shade = scratch->shade + i * Y_SIZE + 1; // y as in opaque
+        int distance = 8;
+        for (int y = top; y > maxy + 1; y--) {
+            int bit = (solid[y >> 6] >> (y & 63)) & 1;
+            distance = bit ? 0 : MIN(distance + 1, 8);
+        }
+        if (maxy == 255) {
+            shade[256] = 0; // nothing above the world
+        }
+        for (int y = MIN(maxy + 1, 255); y >= miny - 1 && y >= 0; y--) {
+            int bit = (solid[y >> 6] >> (y & 63)) & 1;
+            distance = bit ? 0 : MIN(distance + 1, 8);
+            shade[y] = 8 - distance;
+        }
+        if (miny == 0) {
+            shade[-1] = 8 - MIN(distance + 1, 8); // below the world
+        }
+    }
+}
+// the vertex buffer with room for at least faces faces, grown by doubling
+static void *_reserve_faces(MesherScratch *scratch, size_t face_bytes, int faces) {
+    size_t bytes = face_bytes * faces;
+    if (!scratch->vertices) {
+        scratch->vertices_capacity = MAX(scratch->vertices_capacity, bytes);
+        scratch->vertices = malloc(scratch->vertices_capacity);
+    }
+    else if (bytes > scratch->vertices_capacity) {
+        scratch->vertices_capacity = MAX(scratch->vertices_capacity * 2, bytes);
+        scratch->vertices = realloc(scratch->vertices, scratch->vertices_capacity);
+    }
+    return scratch->vertices;
+}
+// zeroes the whole y slices from miny to maxy, clamped to the buffer
+static void _clear_y_range(char *buffer, int miny, int maxy) {
+    miny = MAX(miny, 0);
+    maxy = MIN(maxy, Y_SIZE - 1);
+    if (miny > maxy) {
+        return;
+    }
+    memset(buffer + XYZ(0, miny, 0), 0, XZ_SIZE * XZ_SIZE * (maxy - miny + 1));
+}
@@ -2,27 +2,56 @@
 #define _mesher_h_
 
 #include "map.h"
+#include "block_store.h"
 #include "sign.h"
+#include "cube.h"
+#include "config.h"
 #include <GL/glew.h>
 
+// bytes of a chunk vertex, 10 GLfloat or packed as cube.h describes
+#define MESHER_VERTEX_BYTES(packed) \
+    ((packed) ? sizeof(GLushort) * CUBE_PACKED_COMPONENTS : sizeof(GLfloat) * 10)
+
+// A chunk mesh is made of vertical sections of MESH_SECTION_HEIGHT blocks.
+// Faces never cross a section boundary, so a section can be meshed again
+// and replaced on its own after an edit.
+#define MESHER_SECTIONS (256 / MESH_SECTION_HEIGHT)
+#define MESHER_ALL_SECTIONS ((1u << MESHER_SECTIONS) - 1)
+
+// working buffers of mesher_compute_chunk, kept by a thread across calls
+typedef struct MesherScratch MesherScratch;
+
 typedef struct {
-    Map *block[3][3];
-    Map *light[3][3];
+    BlockStore *block[3][3];
+    Map *light[3][3]; // light levels reaching each block, see lighting.h
     int p, q;
+    int greedy; // merge coplanar faces that look the same into larger quads
+    int packed; // emit packed vertices instead of floats, see cube.h
+    unsigned int sections; // bit per section to mesh, MESHER_ALL_SECTIONS for a whole chunk
+    SignList *signs; // of the chunk, NULL when its sign mesh stays as it is
+    MesherScratch *scratch; // NULL allocates buffers for this call only
 } MesherInput;
 
 typedef struct {
-    GLfloat *data;
+    void *data; // faces * 4 vertices of MESHER_VERTEX_BYTES(packed)
+    int packed;
+    int p, q; // packed positions are relative to this chunk's origin
     int faces;
-    int miny;
+    unsigned int sections; // sections meshed, the others keep their old mesh
+    int section_faces[MESHER_SECTIONS]; // of the meshed sections, one after the other in data
+    int miny; // of the meshed sections
     int maxy;
     //signs
+    int sign_mesh; // sign_data and sign_faces replace the chunk's sign mesh
     GLfloat *sign_data;
     int sign_faces;
 } MesherOutput;
 
+MesherScratch *mesher_scratch_create();
+void mesher_scratch_destroy(MesherScratch *scratch); // not while a call uses it
+
 MesherOutput *mesher_compute_chunk(MesherInput *input);
-void mesher_generate_sign_mesh(MesherOutput *mesher_output, SignList *signs);
+unsigned int mesher_sections_reading(int miny, int maxy);
 void mesher_free_output(MesherOutput **output);
 void mesher_free_output_data(MesherOutput *output);
 
@@ -0,0 +1,73 @@
+#include "radius_governor.h"
+#include <stdio.h>
+#include "config.h"
+#include "util.h"
+
+// INTERNAL HELPERS //
+static int _wanted_step(const RadiusGovernor *governor, int backlog);
+// ========
+
+void radius_governor_init(RadiusGovernor *governor, const ChunkManagerConfig *config,
+    int min_radius, float target_fps)
+{
+    governor->target_ms = 1000.0f / target_fps;
+    governor->max_radius = config->render_radius;
+    governor->min_radius = MIN(min_radius, governor->max_radius);
+    governor->radius = config->render_radius;
+    governor->margin = config->delete_radius - config->render_radius;
+    governor->sign_radius = config->sign_radius;
+    governor->frame_ms = governor->target_ms;
+    governor->out_of_band_since = 0;
+    governor->last_change = 0;
+}
+
+int radius_governor_update(
+    RadiusGovernor *governor, float frame_ms, int backlog, double now)
+{
+    governor->frame_ms += (frame_ms - governor->frame_ms) * GOVERNOR_SMOOTHING;
+    int step = _wanted_step(governor, backlog);
+    if (!step) {
+        governor->out_of_band_since = 0;
+        return 0;
+    }
+    if (!governor->out_of_band_since) {
+        governor->out_of_band_since = now;
+    }
+    if (now - governor->out_of_band_since < GOVERNOR_HOLD_SECONDS ||
+        now - governor->last_change < GOVERNOR_COOLDOWN_SECONDS)
+    {
+        return 0;
+    }
+    if (GOVERNOR_LOG) {
+        fprintf(stderr,
+            "radius governor: frame %.1f ms, target %.1f ms, backlog %d, radius %d -> %d\n",
+            governor->frame_ms, governor->target_ms, backlog,
+            governor->radius, governor->radius + step);
+    }
+    governor->radius += step;
+    governor->out_of_band_since = 0;
+    governor->last_change = now;
+    return 1;
+}
+
+void radius_governor_apply(const RadiusGovernor *governor, ChunkManagerConfig *config) {
+    config->render_radius = governor->radius;
+    config->create_radius = governor->radius;
+    config->delete_radius = governor->radius + governor->margin;
+    config->sign_radius = MIN(governor->sign_radius, governor->radius);
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+
+// -1 above the band, +1 well below it with the workers idle, 0 otherwise
+static int _wanted_step(const RadiusGovernor *governor, int backlog) {
+    if (governor->frame_ms > governor->target_ms * GOVERNOR_SHRINK_ABOVE) {
+        return governor->radius > governor->min_radius ? -1 : 0;
+    }
+    if (governor->frame_ms < governor->target_ms * GOVERNOR_GROW_BELOW &&
+        backlog <= GOVERNOR_MAX_BACKLOG)
+    {
+        return governor->radius < governor->max_radius ? 1 : 0;
+    }
+    return 0;
+}
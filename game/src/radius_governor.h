@@ -0,0 +1,31 @@
+#ifndef _radius_governor_h_
+#define _radius_governor_h_
+
+#include "chunk_manager.h"
+
+// Picks the render radius at runtime from the measured frame time. The
+// radius shrinks when frames stay slower than the target and grows again
+// once they stay well under it with the chunk workers caught up. Both
+// directions need the frame time to stay out of band for a while, and the
+// bands do not meet, so the radius does not flip back and forth.
+
+typedef struct {
+    float target_ms;
+    int min_radius;
+    int max_radius;
+    int radius;
+    int margin; // delete radius minus render radius, kept as configured
+    int sign_radius; // as configured, capped by the radius
+    float frame_ms; // smoothed
+    double out_of_band_since; // when the frame time left the band, 0 while inside
+    double last_change;
+} RadiusGovernor;
+
+void radius_governor_init(RadiusGovernor *governor, const ChunkManagerConfig *config,
+    int min_radius, float target_fps);
+// returns whether the radius changed
+int radius_governor_update(
+    RadiusGovernor *governor, float frame_ms, int backlog, double now);
+void radius_governor_apply(const RadiusGovernor *governor, ChunkManagerConfig *config);
+
+#endif
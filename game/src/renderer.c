@@ -20,11 +20,16 @@ struct Attrib {
     GLuint extra2;
     GLuint extra3;
     GLuint extra4;
+    GLuint extra5;
+    GLuint extra6;
 };
 struct RenderableChunk {
-    int faces; // faces describe the amount of vertices to be drawn
+    int faces; // of all sections
+    int section_faces[MESHER_SECTIONS];
     int sign_faces;
-    GLuint buffer;
+    int packed; // buffers hold packed vertices relative to the chunk at p, q
+    int p, q;
+    GLuint buffers[MESHER_SECTIONS]; // one per mesh section, replaced on its own
     GLuint sign_buffer;
 };
 
@@ -32,7 +37,12 @@ struct Renderer {
     Window *window;
     int renderable_chunk_count;
     RenderableChunk renderable_chunks[MAX_CHUNKS];
+    // ids freed by deletes, reused before new ones so ids held by chunks stay put
+    int free_chunk_ids[MAX_CHUNKS];
+    int free_chunk_id_count;
     GLuint sky_buffer;
+    GLuint quad_index_buffer; // triangles 0 1 2 and 0 2 3 of every quad, see cube.h
+    int quad_index_faces; // quads the index buffer covers
     Attrib block_attrib;
     Attrib line_attrib;
     Attrib text_attrib;
@@ -48,15 +58,19 @@ struct Renderer {
 static GLuint _generate_buffer(GLsizei size, GLfloat *data);
 static void _delete_buffer(GLuint buffer);
 static GLuint _gen_faces(int components, int faces, GLfloat *data);
+static GLuint _gen_chunk_faces(int packed, int faces, void *data);
+static GLuint _gen_quads(int components, int faces, GLfloat *data);
+static void _bind_quad_indices(Renderer *renderer, int faces);
 static GLuint _generate_player_buffer(float x, float y, float z, float rx, float ry);
 static void _draw_triangles_3d(Attrib *attrib, GLuint buffer, int count);
-static void _draw_item(Attrib *attrib, GLuint buffer, int count);
+static void _draw_item(Renderer *renderer, Attrib *attrib, GLuint buffer, int faces);
 static GLuint _generate_plant_buffer(float x, float y, float z, float n, int w);
 static GLuint _generate_cube_buffer(float x, float y, float z, float n, int w);
 static GLuint _generate_crosshair_buffer(const Camera *camera_view, int scale);
 static GLuint _generate_wireframe_buffer(float x, float y, float z, float n);
 static void _draw_lines(Attrib *attrib, GLuint buffer, int components, int count);
-static void _draw_triangles_3d_ao(Attrib *attrib, GLuint buffer, int count);
+static void _draw_quads_3d_ao(Attrib *attrib, GLuint buffer, int faces);
+static void _draw_quads_3d_packed(Attrib *attrib, GLuint buffer, int faces);
 static void _draw_triangles_3d_text(Attrib *attrib, GLuint buffer, int count);
 // ========
 
@@ -72,18 +86,25 @@ Renderer *renderer_create(Window *window) {
         return NULL;
     }
     renderer->sky_buffer = 0;
+    renderer->quad_index_buffer = 0;
+    renderer->quad_index_faces = 0;
     renderer->window = window;
+    renderer->free_chunk_id_count = 0;
     return renderer;
 }
 void renderer_reset(Renderer *renderer) {
     memset(renderer->renderable_chunks, 0, sizeof(RenderableChunk) * MAX_CHUNKS);
     renderer->renderable_chunk_count = 0;
+    renderer->free_chunk_id_count = 0;
 }
 void renderer_destroy(Renderer **renderer) {
     if (renderer && *renderer) {
         if( (*renderer)->sky_buffer ) {
             _delete_buffer((*renderer)->sky_buffer);
         }
+        if ((*renderer)->quad_index_buffer) {
+            _delete_buffer((*renderer)->quad_index_buffer);
+        }
         free(*renderer);
         *renderer = NULL;
     }
@@ -105,27 +126,50 @@ void renderer_delete_chunk_geometry(Renderer *renderer, RenderableObjectID id) {
         return;
     }
     RenderableChunk *chunk = &renderer->renderable_chunks[id];
-    _delete_buffer(chunk->buffer);
+    glDeleteBuffers(MESHER_SECTIONS, chunk->buffers);
     _delete_buffer(chunk->sign_buffer);
-    RenderableChunk *other = &renderer->renderable_chunks[--renderer->renderable_chunk_count];
-    memcpy(chunk, other, sizeof(RenderableChunk));
+    memset(chunk, 0, sizeof(RenderableChunk));
+    renderer->free_chunk_ids[renderer->free_chunk_id_count++] = id;
 }
+// replaces the sections the mesh covers, and the signs when it has a sign
+// mesh, the rest of the chunk stays
 void renderer_upload_chunk_geometry(Renderer *renderer, RenderableObjectID *id_ptr, MesherOutput *mesh_data) {
     if(!id_ptr || !mesh_data || *id_ptr >= MAX_CHUNKS) {
         return;
     }
-    if(*id_ptr != INVALID_RENDERABLE_OBJECT_ID) {
-        _delete_buffer(renderer->renderable_chunks[*id_ptr].buffer);
-        _delete_buffer(renderer->renderable_chunks[*id_ptr].sign_buffer);
-    }
-    else {
-        *id_ptr = renderer->renderable_chunk_count++;
+    if(*id_ptr == INVALID_RENDERABLE_OBJECT_ID) {
+        if (renderer->free_chunk_id_count) {
+            *id_ptr = renderer->free_chunk_ids[--renderer->free_chunk_id_count];
+        }
+        else {
+            *id_ptr = renderer->renderable_chunk_count++;
+        }
     }
     RenderableChunk *chunk = &renderer->renderable_chunks[*id_ptr];
-    chunk->faces = mesh_data->faces;
-    chunk->sign_faces = mesh_data->sign_faces;
-    chunk->buffer = _gen_faces(10, mesh_data->faces, mesh_data->data);
-    chunk->sign_buffer = _gen_faces(5, chunk->sign_faces, mesh_data->sign_data);
+    chunk->packed = mesh_data->packed;
+    chunk->p = mesh_data->p;
+    chunk->q = mesh_data->q;
+    char *data = (char *)mesh_data->data;
+    size_t face_bytes = MESHER_VERTEX_BYTES(mesh_data->packed) * 4;
+    for (int i = 0; i < MESHER_SECTIONS; i++) {
+        if (!(mesh_data->sections & (1u << i))) {
+            continue;
+        }
+        int faces = mesh_data->section_faces[i];
+        _delete_buffer(chunk->buffers[i]);
+        chunk->buffers[i] = faces ? _gen_chunk_faces(mesh_data->packed, faces, data) : 0;
+        chunk->section_faces[i] = faces;
+        data += face_bytes * faces;
+    }
+    chunk->faces = 0;
+    for (int i = 0; i < MESHER_SECTIONS; i++) {
+        chunk->faces += chunk->section_faces[i];
+    }
+    if (mesh_data->sign_mesh) {
+        _delete_buffer(chunk->sign_buffer);
+        chunk->sign_faces = mesh_data->sign_faces;
+        chunk->sign_buffer = _gen_faces(5, chunk->sign_faces, mesh_data->sign_data);
+    }
 }
 void renderer_update_player(Renderer *renderer, Player *player) {
     if(!renderer || !player) {
@@ -173,7 +217,23 @@ void renderer_draw_chunk(Renderer *renderer, RenderableObjectID id) {
         return;
     }
     RenderableChunk *chunk = &renderer->renderable_chunks[id];
-    _draw_triangles_3d_ao(&renderer->block_attrib, chunk->buffer, chunk->faces * 6);
+    Attrib *attrib = &renderer->block_attrib;
+    glUniform1i(attrib->extra5, chunk->packed);
+    if (chunk->packed) {
+        glUniform3f(attrib->extra6, chunk->p * CHUNK_SIZE, 0, chunk->q * CHUNK_SIZE);
+    }
+    _bind_quad_indices(renderer, chunk->faces); // no section has more
+    for (int i = 0; i < MESHER_SECTIONS; i++) {
+        if (!chunk->section_faces[i]) {
+            continue;
+        }
+        if (chunk->packed) {
+            _draw_quads_3d_packed(attrib, chunk->buffers[i], chunk->section_faces[i]);
+        }
+        else {
+            _draw_quads_3d_ao(attrib, chunk->buffers[i], chunk->section_faces[i]);
+        }
+    }
 }
 void renderer_begin_sign_pass(Renderer *renderer, const Camera *camera_view) {
     glUseProgram(renderer->text_attrib.program);
@@ -224,16 +284,17 @@ void renderer_begin_item_pass(Renderer *renderer, const Camera *camera_view, flo
     glUniformMatrix4fv(renderer->block_attrib.matrix, 1, GL_FALSE, matrix);
     glUniform3f(renderer->block_attrib.camera, 0, 0, 5);
     glUniform1i(renderer->block_attrib.sampler, 0);
+    glUniform1i(renderer->block_attrib.extra5, 0);
     glUniform1f(renderer->block_attrib.timer, time_of_day);
 }
 void renderer_draw_plant(Renderer *renderer, int plant_type) {
     GLuint buffer = _generate_plant_buffer(0, 0, 0, 0.5, plant_type);
-    _draw_item(&renderer->block_attrib, buffer, 24);
+    _draw_item(renderer, &renderer->block_attrib, buffer, 4);
     _delete_buffer(buffer);
 }
 void renderer_draw_cube(Renderer *renderer, int cube_type) {
     GLuint buffer = _generate_cube_buffer(0, 0, 0, 0.5, cube_type);
-    _draw_item(&renderer->block_attrib, buffer, 36);
+    _draw_item(renderer, &renderer->block_attrib, buffer, 6);
     _delete_buffer(buffer);
 }
 void renderer_begin_hud_pass(Renderer *renderer) {
@@ -297,6 +358,8 @@ void renderer_load_block_shaders(Renderer *renderer) {
     renderer->block_attrib.extra2 = glGetUniformLocation(program, "daylight");
     renderer->block_attrib.extra3 = glGetUniformLocation(program, "fog_distance");
     renderer->block_attrib.extra4 = glGetUniformLocation(program, "ortho");
+    renderer->block_attrib.extra5 = glGetUniformLocation(program, "packed_vertices");
+    renderer->block_attrib.extra6 = glGetUniformLocation(program, "origin");
     renderer->block_attrib.camera = glGetUniformLocation(program, "camera");
     renderer->block_attrib.timer = glGetUniformLocation(program, "timer");
 }
@@ -350,10 +413,38 @@ static GLuint _gen_faces(int components, int faces, GLfloat *data) {
         sizeof(GLfloat) * 6 * components * faces, data);
     return buffer;
 }
+static GLuint _gen_chunk_faces(int packed, int faces, void *data) {
+    return _generate_buffer(MESHER_VERTEX_BYTES(packed) * 4 * faces, data);
+}
+static GLuint _gen_quads(int components, int faces, GLfloat *data) {
+    return _generate_buffer(sizeof(GLfloat) * 4 * components * faces, data);
+}
+// grows the shared index buffer to cover at least faces quads and binds it
+static void _bind_quad_indices(Renderer *renderer, int faces) {
+    if (faces > renderer->quad_index_faces) {
+        int count = MAX(faces, renderer->quad_index_faces * 2);
+        GLuint *indices = (GLuint *)malloc(sizeof(GLuint) * 6 * count);
+        for (int i = 0; i < count; i++) {
+            GLuint *d = indices + i * 6;
+            d[0] = i * 4; d[1] = i * 4 + 1; d[2] = i * 4 + 2;
+            d[3] = i * 4; d[4] = i * 4 + 2; d[5] = i * 4 + 3;
+        }
+        if (renderer->quad_index_buffer) {
+            _delete_buffer(renderer->quad_index_buffer);
+        }
+        glGenBuffers(1, &renderer->quad_index_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->quad_index_buffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 6 * count, indices, GL_STATIC_DRAW);
+        free(indices);
+        renderer->quad_index_faces = count;
+        return;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->quad_index_buffer);
+}
 static GLuint _generate_player_buffer(float x, float y, float z, float rx, float ry) {
-    GLfloat *data = malloc_faces(10, 6);
+    GLfloat *data = malloc_quads(10, 6);
     make_player(data, x, y, z, rx, ry);
-    return _gen_faces(10, 6, data);
+    return _gen_quads(10, 6, data);
 }
 static void _draw_triangles_3d(Attrib *attrib, GLuint buffer, int count) {
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
@@ -372,18 +463,19 @@ static void _draw_triangles_3d(Attrib *attrib, GLuint buffer, int count) {
     glDisableVertexAttribArray(attrib->uv);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
-static void _draw_item(Attrib *attrib, GLuint buffer, int count) {
-    _draw_triangles_3d_ao(attrib, buffer, count);
+static void _draw_item(Renderer *renderer, Attrib *attrib, GLuint buffer, int faces) {
+    _bind_quad_indices(renderer, faces);
+    _draw_quads_3d_ao(attrib, buffer, faces);
 }
 static GLuint _generate_plant_buffer(float x, float y, float z, float n, int w) {
-    GLfloat *data = malloc_faces(10, 4);
+    GLfloat *data = malloc_quads(10, 4);
     float ao = 0;
     float light = 1;
     make_plant(data, ao, light, x, y, z, n, w, 45);
-    return _gen_faces(10, 4, data);
+    return _gen_quads(10, 4, data);
 }
 static GLuint _generate_cube_buffer(float x, float y, float z, float n, int w) {
-    GLfloat *data = malloc_faces(10, 6);
+    GLfloat *data = malloc_quads(10, 6);
     float ao[6][4] = {0};
     float light[6][4] = {
         {0.5, 0.5, 0.5, 0.5},
@@ -393,7 +485,7 @@ static GLuint _generate_cube_buffer(float x, float y, float z, float n, int w) {
         {0.5, 0.5, 0.5, 0.5},
         {0.5, 0.5, 0.5, 0.5}};
     make_cube(data, ao, light, 1, 1, 1, 1, 1, 1, x, y, z, n, w);
-    return _gen_faces(10, 6, data);
+    return _gen_quads(10, 6, data);
 }
 static GLuint _generate_crosshair_buffer(const Camera *camera_view, int scale) {
     int x = camera_view->window_width / 2;
@@ -418,7 +510,8 @@ static void _draw_lines(Attrib *attrib, GLuint buffer, int components, int count
     glDisableVertexAttribArray(attrib->position);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
-static void _draw_triangles_3d_ao(Attrib *attrib, GLuint buffer, int count) {
+// the quad index buffer must be bound, see _bind_quad_indices
+static void _draw_quads_3d_ao(Attrib *attrib, GLuint buffer, int faces) {
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
     glEnableVertexAttribArray(attrib->position);
     glEnableVertexAttribArray(attrib->normal);
@@ -429,12 +522,23 @@ static void _draw_triangles_3d_ao(Attrib *attrib, GLuint buffer, int count) {
                           sizeof(GLfloat) * 10, (GLvoid *)(sizeof(GLfloat) * 3));
     glVertexAttribPointer(attrib->uv, 4, GL_FLOAT, GL_FALSE,
                           sizeof(GLfloat) * 10, (GLvoid *)(sizeof(GLfloat) * 6));
-    glDrawArrays(GL_TRIANGLES, 0, count);
+    glDrawElements(GL_TRIANGLES, faces * 6, GL_UNSIGNED_INT, 0);
     glDisableVertexAttribArray(attrib->position);
     glDisableVertexAttribArray(attrib->normal);
     glDisableVertexAttribArray(attrib->uv);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
+// the shader reads the four shorts of cube.h as they are, normal and uv
+// are left to their defaults
+static void _draw_quads_3d_packed(Attrib *attrib, GLuint buffer, int faces) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glEnableVertexAttribArray(attrib->position);
+    glVertexAttribPointer(attrib->position, CUBE_PACKED_COMPONENTS, GL_UNSIGNED_SHORT,
+                          GL_FALSE, sizeof(GLushort) * CUBE_PACKED_COMPONENTS, 0);
+    glDrawElements(GL_TRIANGLES, faces * 6, GL_UNSIGNED_INT, 0);
+    glDisableVertexAttribArray(attrib->position);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 static void _draw_triangles_3d_text(Attrib *attrib, GLuint buffer, int count) {
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
     glEnableVertexAttribArray(attrib->position);
@@ -0,0 +1,276 @@
+#include <stdlib.h>
+#include <string.h>
+#include "section_store.h"
+
+#define SECTION_WORDS(bits) (SECTION_VOLUME * (bits) / 64)
+
+// bytes duplicated by section_store_copy and copy-on-write, for profiling
+static unsigned long long copied_bytes = 0;
+
+// INTERNAL HELPERS //
+static Section *_section_create();
+static void _section_release(Section *section);
+static Section *_section_clone(const Section *section);
+static void _section_repack(Section *section, int bits, const int *remap);
+static void _section_compact(Section *section);
+static int _section_palette_slot(Section *section, int w);
+static void _section_set_slot(Section *section, int index, int slot);
+// ========
+
+void section_store_alloc(SectionStore *store, int dx, int dy, int dz) {
+    store->dx = dx;
+    store->dy = dy;
+    store->dz = dz;
+    store->size = 0;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        store->sections[i] = NULL;
+    }
+}
+
+void section_store_free(SectionStore *store) {
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        _section_release(store->sections[i]);
+        store->sections[i] = NULL;
+    }
+    store->size = 0;
+}
+
+void section_store_copy(SectionStore *dst, SectionStore *src) {
+    dst->dx = src->dx;
+    dst->dy = src->dy;
+    dst->dz = src->dz;
+    dst->size = src->size;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        dst->sections[i] = _section_clone(src->sections[i]);
+    }
+}
+
+// shares every section with src; a store about to write into a shared
+// section clones just that section first (see section_store_set)
+void section_store_share(SectionStore *dst, SectionStore *src) {
+    memcpy(dst, src, sizeof(SectionStore));
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (dst->sections[i]) {
+            dst->sections[i]->refs++;
+        }
+    }
+}
+
+int section_store_set(SectionStore *store, int x, int y, int z, int w) {
+    x -= store->dx;
+    y -= store->dy;
+    z -= store->dz;
+    if (x < 0 || x >= SECTION_SIDE) return 0;
+    if (y < 0 || y >= SECTION_COUNT * SECTION_HEIGHT) return 0;
+    if (z < 0 || z >= SECTION_SIDE) return 0;
+    w = (signed char)w;
+    Section **slot = store->sections + y / SECTION_HEIGHT;
+    Section *section = *slot;
+    if (!section) {
+        if (!w) {
+            return 0;
+        }
+        section = *slot = _section_create();
+    }
+    int index = SECTION_INDEX(x, y % SECTION_HEIGHT, z);
+    int previous = section_get_cell(section, index);
+    if (previous == w) {
+        return 0;
+    }
+    if (section->refs > 1) {
+        section->refs--;
+        section = *slot = _section_clone(section);
+    }
+    _section_set_slot(section, index, _section_palette_slot(section, w));
+    if (!previous) {
+        section->count++;
+        store->size++;
+    }
+    else if (!w) {
+        section->count--;
+        store->size--;
+        if (section->count == 0) {
+            _section_release(section);
+            *slot = NULL;
+        }
+    }
+    return 1;
+}
+
+// sets y0 <= y < y1 of one column to w, one section and palette lookup per
+// section instead of per cell. The cells of a column lie next to each
+// other in a section (see SECTION_INDEX).
+int section_store_fill(SectionStore *store, int x, int z, int y0, int y1, int w) {
+    x -= store->dx;
+    z -= store->dz;
+    y0 -= store->dy;
+    y1 -= store->dy;
+    if (x < 0 || x >= SECTION_SIDE) return 0;
+    if (z < 0 || z >= SECTION_SIDE) return 0;
+    if (y0 < 0) y0 = 0;
+    if (y1 > SECTION_COUNT * SECTION_HEIGHT) y1 = SECTION_COUNT * SECTION_HEIGHT;
+    w = (signed char)w;
+    int changed = 0;
+    while (y0 < y1) {
+        int ly = y0 % SECTION_HEIGHT;
+        int count = SECTION_HEIGHT - ly < y1 - y0 ? SECTION_HEIGHT - ly : y1 - y0;
+        Section **slot = store->sections + y0 / SECTION_HEIGHT;
+        Section *section = *slot;
+        y0 += count;
+        if (!section) {
+            if (!w) {
+                continue;
+            }
+            section = *slot = _section_create();
+        }
+        else if (section->refs > 1) {
+            section->refs--;
+            section = *slot = _section_clone(section);
+        }
+        int fill = _section_palette_slot(section, w);
+        int bits = section->bits;
+        uint64_t mask = (1u << bits) - 1;
+        int added = 0;
+        unsigned int bit = (unsigned int)SECTION_INDEX(x, ly, z) * bits;
+        for (int i = 0; i < count; i++, bit += bits) {
+            uint64_t *word = section->data + (bit >> 6);
+            int previous = (int)((*word >> (bit & 63)) & mask);
+            if (previous == fill) {
+                continue;
+            }
+            // slot 0 is air, and air has no other slot
+            added += !previous - !fill;
+            *word = (*word & ~(mask << (bit & 63))) | ((uint64_t)fill << (bit & 63));
+            changed = 1;
+        }
+        section->count += added;
+        store->size += added;
+        if (section->count == 0) {
+            _section_release(section);
+            *slot = NULL;
+        }
+    }
+    return changed;
+}
+
+int section_store_get(SectionStore *store, int x, int y, int z) {
+    x -= store->dx;
+    y -= store->dy;
+    z -= store->dz;
+    if (x < 0 || x >= SECTION_SIDE) return 0;
+    if (y < 0 || y >= SECTION_COUNT * SECTION_HEIGHT) return 0;
+    if (z < 0 || z >= SECTION_SIDE) return 0;
+    Section *section = store->sections[y / SECTION_HEIGHT];
+    if (!section) {
+        return 0;
+    }
+    return section_get_cell(section, SECTION_INDEX(x, y % SECTION_HEIGHT, z));
+}
+
+unsigned long long section_store_copied_bytes() {
+    return copied_bytes;
+}
+
+size_t section_store_memory_usage(SectionStore *store) {
+    size_t result = sizeof(SectionStore);
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        Section *section = store->sections[i];
+        if (section) {
+            result += sizeof(Section);
+            result += SECTION_WORDS(section->bits) * sizeof(uint64_t);
+        }
+    }
+    return result;
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+static Section *_section_create() {
+    Section *section = (Section *)malloc(sizeof(Section));
+    section->count = 0;
+    section->bits = 1;
+    section->palette_size = 1;
+    section->palette[0] = 0;
+    section->refs = 1;
+    section->data = (uint64_t *)calloc(SECTION_WORDS(1), sizeof(uint64_t));
+    return section;
+}
+static void _section_release(Section *section) {
+    if (section && --section->refs == 0) {
+        free(section->data);
+        free(section);
+    }
+}
+static Section *_section_clone(const Section *section) {
+    if (!section) {
+        return NULL;
+    }
+    Section *result = (Section *)malloc(sizeof(Section));
+    memcpy(result, section, sizeof(Section));
+    size_t size = SECTION_WORDS(section->bits) * sizeof(uint64_t);
+    result->refs = 1;
+    result->data = (uint64_t *)malloc(size);
+    memcpy(result->data, section->data, size);
+    copied_bytes += sizeof(Section) + size;
+    return result;
+}
+// rewrites every cell with a new index width, optionally renumbering slots
+static void _section_repack(Section *section, int bits, const int *remap) {
+    uint64_t *data = (uint64_t *)calloc(SECTION_WORDS(bits), sizeof(uint64_t));
+    int old_bits = section->bits;
+    uint64_t old_mask = (1u << old_bits) - 1;
+    for (int i = 0; i < SECTION_VOLUME; i++) {
+        unsigned int old_bit = (unsigned int)i * old_bits;
+        int slot = (section->data[old_bit >> 6] >> (old_bit & 63)) & old_mask;
+        if (remap) {
+            slot = remap[slot];
+        }
+        unsigned int bit = (unsigned int)i * bits;
+        data[bit >> 6] |= (uint64_t)slot << (bit & 63);
+    }
+    free(section->data);
+    section->data = data;
+    section->bits = bits;
+}
+// drops palette entries no cell refers to any more
+static void _section_compact(Section *section) {
+    int used[SECTION_MAX_PALETTE] = {0};
+    int remap[SECTION_MAX_PALETTE];
+    uint64_t mask = (1u << section->bits) - 1;
+    for (int i = 0; i < SECTION_VOLUME; i++) {
+        unsigned int bit = (unsigned int)i * section->bits;
+        used[(section->data[bit >> 6] >> (bit & 63)) & mask] = 1;
+    }
+    used[0] = 1;
+    int size = 0;
+    for (int i = 0; i < section->palette_size; i++) {
+        if (used[i]) {
+            section->palette[size] = section->palette[i];
+            remap[i] = size++;
+        }
+    }
+    if (size != section->palette_size) {
+        section->palette_size = size;
+        _section_repack(section, section->bits, remap);
+    }
+}
+static int _section_palette_slot(Section *section, int w) {
+    for (int i = 0; i < section->palette_size; i++) {
+        if (section->palette[i] == w) {
+            return i;
+        }
+    }
+    if (section->palette_size == (1 << section->bits)) {
+        _section_compact(section);
+    }
+    if (section->palette_size == (1 << section->bits)) {
+        _section_repack(section, section->bits * 2, NULL);
+    }
+    section->palette[section->palette_size] = w;
+    return section->palette_size++;
+}
+static void _section_set_slot(Section *section, int index, int slot) {
+    unsigned int bit = (unsigned int)index * section->bits;
+    uint64_t mask = ((uint64_t)((1u << section->bits) - 1)) << (bit & 63);
+    uint64_t *word = section->data + (bit >> 6);
+    *word = (*word & ~mask) | ((uint64_t)slot << (bit & 63));
+}
@@ -0,0 +1,57 @@
+#ifndef _section_store_h_
+#define _section_store_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// Dense block storage split into vertical sections. The footprint covers the
+// chunk plus the one-block overlap ring the Map also keeps, so both stores
+// hold exactly the same blocks. Every section maps its cells through a small
+// palette to bit-packed indices; sections that are all air are not allocated.
+
+#define SECTION_SIDE (CHUNK_SIZE + 2)
+#define SECTION_HEIGHT 16
+#define SECTION_COUNT (256 / SECTION_HEIGHT)
+#define SECTION_VOLUME (SECTION_SIDE * SECTION_SIDE * SECTION_HEIGHT)
+#define SECTION_MAX_PALETTE 256
+
+// cells are laid out column by column, y varies fastest
+#define SECTION_INDEX(lx, ly, lz) \
+    (((lx) * SECTION_SIDE + (lz)) * SECTION_HEIGHT + (ly))
+
+typedef struct {
+    unsigned int count; // non-air cells
+    int bits; // bits per packed index: 1, 2, 4 or 8
+    int palette_size;
+    signed char palette[SECTION_MAX_PALETTE]; // palette[0] is always air
+    unsigned int refs; // stores sharing this section, main thread only
+    uint64_t *data;
+} Section;
+
+typedef struct {
+    int dx;
+    int dy;
+    int dz;
+    unsigned int size; // non-air cells in all sections
+    Section *sections[SECTION_COUNT];
+} SectionStore;
+
+void section_store_alloc(SectionStore *store, int dx, int dy, int dz);
+void section_store_free(SectionStore *store);
+void section_store_copy(SectionStore *dst, SectionStore *src);
+void section_store_share(SectionStore *dst, SectionStore *src);
+int section_store_set(SectionStore *store, int x, int y, int z, int w);
+int section_store_fill(SectionStore *store, int x, int z, int y0, int y1, int w);
+int section_store_get(SectionStore *store, int x, int y, int z);
+size_t section_store_memory_usage(SectionStore *store);
+unsigned long long section_store_copied_bytes();
+
+static inline int section_get_cell(const Section *section, int index) {
+    int bits = section->bits;
+    unsigned int bit = (unsigned int)index * bits;
+    unsigned int value = (unsigned int)(section->data[bit >> 6] >> (bit & 63));
+    return section->palette[value & ((1u << bits) - 1)];
+}
+
+#endif
@@ -12,6 +12,12 @@ void sign_list_free(SignList *list) {
     free(list->data);
 }
 
+void sign_list_copy(SignList *dst, SignList *src) {
+    sign_list_alloc(dst, src->capacity);
+    memcpy(dst->data, src->data, src->size * sizeof(Sign));
+    dst->size = src->size;
+}
+
 void sign_list_grow(SignList *list) {
     SignList new_list;
     sign_list_alloc(&new_list, list->capacity * 2);
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include "tinycthread.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+typedef struct {
+    ThreadPoolTaskFunc func;
+    void *arg;
+} ThreadPoolTask;
+
+// ring buffer, the owner works at the bottom and thieves take from the top
+typedef struct {
+    mtx_t mtx;
+    ThreadPoolTask *tasks;
+    unsigned int mask;
+    unsigned int top;
+    unsigned int bottom;
+} TaskDeque;
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+    thrd_t thrd;
+    TaskDeque deque; // tasks spawned on this thread, run newest first
+    TaskDeque inbox; // tasks submitted from outside the pool, run oldest first
+} PoolThread;
+
+struct ThreadPool {
+    PoolThread *threads;
+    int thread_count;
+    unsigned int next_thread; // round robin target for outside submissions
+    tss_t current; // PoolThread of the calling thread, NULL outside the pool
+    mtx_t mtx;
+    cnd_t cnd;
+    int pending; // submitted tasks nobody has taken yet
+    int running;
+};
+
+// INTERNAL HELPERS //
+static int _thread_run(void *arg);
+static int _take_task(PoolThread *thread, ThreadPoolTask *task);
+static void _deque_alloc(TaskDeque *deque);
+static void _deque_free(TaskDeque *deque);
+static void _deque_push(TaskDeque *deque, ThreadPoolTask task);
+static int _deque_pop(TaskDeque *deque, ThreadPoolTask *task);
+static int _deque_steal(TaskDeque *deque, ThreadPoolTask *task);
+// ========
+
+ThreadPool *thread_pool_create(int thread_count) {
+    ThreadPool *pool = (ThreadPool *)malloc(sizeof(ThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+    if (thread_count <= 0) {
+        // leave one core to the main thread
+        thread_count = thread_pool_hardware_threads() - 1;
+        if (thread_count < 1) {
+            thread_count = 1;
+        }
+    }
+    pool->threads = (PoolThread *)malloc(sizeof(PoolThread) * thread_count);
+    pool->thread_count = thread_count;
+    pool->next_thread = 0;
+    pool->pending = 0;
+    pool->running = 1;
+    tss_create(&pool->current, NULL);
+    mtx_init(&pool->mtx, mtx_plain);
+    cnd_init(&pool->cnd);
+    for (int i = 0; i < thread_count; i++) {
+        PoolThread *thread = pool->threads + i;
+        thread->pool = pool;
+        thread->index = i;
+        _deque_alloc(&thread->deque);
+        _deque_alloc(&thread->inbox);
+    }
+    for (int i = 0; i < thread_count; i++) {
+        PoolThread *thread = pool->threads + i;
+        thrd_create(&thread->thrd, _thread_run, thread);
+    }
+    return pool;
+}
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) {
+        return;
+    }
+    mtx_lock(&pool->mtx);
+    pool->running = 0;
+    cnd_broadcast(&pool->cnd);
+    mtx_unlock(&pool->mtx);
+    for (int i = 0; i < pool->thread_count; i++) {
+        thrd_join(pool->threads[i].thrd, NULL);
+    }
+    for (int i = 0; i < pool->thread_count; i++) {
+        _deque_free(&pool->threads[i].deque);
+        _deque_free(&pool->threads[i].inbox);
+    }
+    cnd_destroy(&pool->cnd);
+    mtx_destroy(&pool->mtx);
+    tss_delete(pool->current);
+    free(pool->threads);
+    free(pool);
+}
+void thread_pool_submit(ThreadPool *pool, ThreadPoolTaskFunc func, void *arg) {
+    ThreadPoolTask task = {func, arg};
+    // tasks spawned by a task stay on their thread, where the data is warm.
+    // Outside submissions keep their order, callers hand out the most
+    // urgent work first.
+    PoolThread *thread = (PoolThread *)tss_get(pool->current);
+    TaskDeque *deque = thread ? &thread->deque : NULL;
+    if (!thread) {
+        thread = pool->threads + pool->next_thread;
+        pool->next_thread = (pool->next_thread + 1) % pool->thread_count;
+        deque = &thread->inbox;
+    }
+    // counted before it becomes visible, so a thief can never take a task
+    // pending does not know about yet
+    mtx_lock(&pool->mtx);
+    pool->pending++;
+    mtx_unlock(&pool->mtx);
+    _deque_push(deque, task);
+    mtx_lock(&pool->mtx);
+    cnd_signal(&pool->cnd);
+    mtx_unlock(&pool->mtx);
+}
+int thread_pool_get_thread_count(ThreadPool *pool) {
+    return pool->thread_count;
+}
+int thread_pool_get_thread_index(ThreadPool *pool) {
+    PoolThread *thread = (PoolThread *)tss_get(pool->current);
+    return thread ? thread->index : -1;
+}
+int thread_pool_hardware_threads() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+static int _thread_run(void *arg) {
+    PoolThread *thread = (PoolThread *)arg;
+    ThreadPool *pool = thread->pool;
+    tss_set(pool->current, thread);
+    while (1) {
+        ThreadPoolTask task;
+        if (_take_task(thread, &task)) {
+            mtx_lock(&pool->mtx);
+            pool->pending--;
+            mtx_unlock(&pool->mtx);
+            task.func(task.arg);
+            continue;
+        }
+        mtx_lock(&pool->mtx);
+        while (pool->running && pool->pending == 0) {
+            cnd_wait(&pool->cnd, &pool->mtx);
+        }
+        int done = !pool->running && pool->pending == 0;
+        mtx_unlock(&pool->mtx);
+        if (done) {
+            break;
+        }
+    }
+    return 0;
+}
+// own spawned tasks newest first, then own submissions oldest first, then
+// the oldest task of another thread, submissions before spawned ones
+static int _take_task(PoolThread *thread, ThreadPoolTask *task) {
+    if (_deque_pop(&thread->deque, task) || _deque_steal(&thread->inbox, task)) {
+        return 1;
+    }
+    ThreadPool *pool = thread->pool;
+    for (int i = 1; i < pool->thread_count; i++) {
+        PoolThread *victim = pool->threads + (thread->index + i) % pool->thread_count;
+        if (_deque_steal(&victim->inbox, task) || _deque_steal(&victim->deque, task)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+static void _deque_alloc(TaskDeque *deque) {
+    mtx_init(&deque->mtx, mtx_plain);
+    deque->mask = 63;
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->tasks = (ThreadPoolTask *)malloc(sizeof(ThreadPoolTask) * (deque->mask + 1));
+}
+static void _deque_free(TaskDeque *deque) {
+    free(deque->tasks);
+    mtx_destroy(&deque->mtx);
+}
+static void _deque_push(TaskDeque *deque, ThreadPoolTask task) {
+    mtx_lock(&deque->mtx);
+    if (deque->bottom - deque->top > deque->mask) {
+        unsigned int mask = (deque->mask << 1) | 1;
+        ThreadPoolTask *tasks = (ThreadPoolTask *)malloc(sizeof(ThreadPoolTask) * (mask + 1));
+        for (unsigned int i = deque->top; i != deque->bottom; i++) {
+            tasks[i & mask] = deque->tasks[i & deque->mask];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->mask = mask;
+    }
+    deque->tasks[deque->bottom++ & deque->mask] = task;
+    mtx_unlock(&deque->mtx);
+}
+static int _deque_pop(TaskDeque *deque, ThreadPoolTask *task) {
+    int result = 0;
+    mtx_lock(&deque->mtx);
+    if (deque->bottom != deque->top) {
+        *task = deque->tasks[--deque->bottom & deque->mask];
+        result = 1;
+    }
+    mtx_unlock(&deque->mtx);
+    return result;
+}
+static int _deque_steal(TaskDeque *deque, ThreadPoolTask *task) {
+    int result = 0;
+    mtx_lock(&deque->mtx);
+    if (deque->bottom != deque->top) {
+        *task = deque->tasks[deque->top++ & deque->mask];
+        result = 1;
+    }
+    mtx_unlock(&deque->mtx);
+    return result;
+}
@@ -0,0 +1,24 @@
+#ifndef _thread_pool_h_
+#define _thread_pool_h_
+
+// Fixed set of worker threads, each owning its queued tasks. A thread pops
+// the tasks it spawned itself newest first, and the tasks submitted from
+// outside the pool in submission order, so a caller that submits its most
+// urgent work first gets it run first. Once it runs dry it steals the
+// oldest task from another thread, so no thread idles while others are
+// backlogged.
+
+typedef void (*ThreadPoolTaskFunc)(void *arg);
+
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool *thread_pool_create(int thread_count); // <= 0 sizes it to the hardware
+void thread_pool_destroy(ThreadPool *pool); // runs the queued tasks, then joins
+
+void thread_pool_submit(ThreadPool *pool, ThreadPoolTaskFunc func, void *arg);
+int thread_pool_get_thread_count(ThreadPool *pool);
+int thread_pool_get_thread_index(ThreadPool *pool); // of the caller, -1 outside the pool
+
+int thread_pool_hardware_threads();
+
+#endif
@@ -1,6 +1,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "lodepng.h"
 #include "matrix.h"
@@ -27,6 +28,31 @@ void update_fps(FPS *fps) {
     }
 }
 
+void frame_times_add(FrameTimes *times, float ms) {
+    times->samples[times->next] = ms;
+    times->next = (times->next + 1) % FRAME_TIME_SAMPLES;
+    if (times->count < FRAME_TIME_SAMPLES) {
+        times->count++;
+    }
+}
+
+static int _compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+float frame_times_percentile(const FrameTimes *times, float percentile) {
+    if (!times->count) {
+        return 0;
+    }
+    float sorted[FRAME_TIME_SAMPLES];
+    memcpy(sorted, times->samples, sizeof(float) * times->count);
+    qsort(sorted, times->count, sizeof(float), _compare_floats);
+    int index = (int)(percentile / 100 * (times->count - 1) + 0.5f);
+    return sorted[index];
+}
+
 char *load_file(const char *path) {
     FILE *file = fopen(path, "rb");
     if (!file) {
@@ -46,6 +72,11 @@ GLfloat *malloc_faces(int components, int faces) {
     return malloc(sizeof(GLfloat) * 6 * components * faces);
 }
 
+// faces of four vertices, for the indexed meshes of cube.h
+GLfloat *malloc_quads(int components, int faces) {
+    return malloc(sizeof(GLfloat) * 4 * components * faces);
+}
+
 GLuint make_shader(GLenum type, const char *source) {
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, NULL);
@@ -25,11 +25,20 @@ typedef struct {
     double since;
 } FPS;
 
+typedef struct {
+    float samples[FRAME_TIME_SAMPLES]; // milliseconds, oldest overwritten first
+    int count;
+    int next;
+} FrameTimes;
+
 int rand_int(int n);
 double rand_double();
 void update_fps(FPS *fps);
+void frame_times_add(FrameTimes *times, float ms);
+float frame_times_percentile(const FrameTimes *times, float percentile);
 
 GLfloat *malloc_faces(int components, int faces);
+GLfloat *malloc_quads(int components, int faces);
 GLuint make_shader(GLenum type, const char *source);
 GLuint load_shader(GLenum type, const char *path);
 GLuint make_program(GLuint shader1, GLuint shader2);
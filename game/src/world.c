@@ -1,8 +1,55 @@
+#include <stddef.h>
+#include <stdlib.h>
 #include "config.h"
 #include "noise.h"
 #include "world.h"
 
+#define WORLD_SIDE (CHUNK_SIZE + 2)
+#define WORLD_COLUMNS (WORLD_SIDE * WORLD_SIDE)
+#define CLOUD_LAYERS 8 // y = 64 to 71
+
+// The chunk's noise, evaluated for many columns per simplex2_batch call
+// before any block is placed. Plants and trees only need it on land, so
+// those layers are packed in column order for just the columns that read
+// them.
+typedef struct {
+    float x[WORLD_COLUMNS];
+    float y[WORLD_COLUMNS];
+    float z[WORLD_COLUMNS];
+    float f[WORLD_COLUMNS];
+    float g[WORLD_COLUMNS];
+    float grass[WORLD_COLUMNS];
+    float flowers[WORLD_COLUMNS];
+    float trees[WORLD_COLUMNS];
+    int land[WORLD_COLUMNS]; // columns with grass on top
+    int tree_land[WORLD_COLUMNS]; // and far enough inside for a tree
+    float clouds[CLOUD_LAYERS][WORLD_COLUMNS];
+} WorldNoise;
+
+// INTERNAL HELPERS //
+static void _compute_noise(WorldNoise *noise, int p, int q);
+static void _noise2(WorldNoise *noise, int p, int q,
+    const int *columns, int count, double sx, double sz,
+    float *out, int octaves, float persistence, float lacunarity);
+static int _column_height(WorldNoise *noise, int i, int *w);
+static int _tree_column(int dx, int dz);
+static void _fill(world_func func, world_fill_func fill, void *arg,
+    int x, int z, int y0, int y1, int w);
+// ========
+
 void create_world(int p, int q, world_func func, void *arg) {
+    create_world_columns(p, q, func, NULL, arg);
+}
+
+// same blocks in the same order as create_world, but vertical runs go to
+// fill in one call when it is given
+void create_world_columns(
+    int p, int q, world_func func, world_fill_func fill, void *arg)
+{
+    WorldNoise *noise = (WorldNoise *)malloc(sizeof(WorldNoise));
+    _compute_noise(noise, p, q);
+    int plant = 0;
+    int tree = 0;
     int pad = 1;
     for (int dx = -pad; dx < CHUNK_SIZE + pad; dx++) {
         for (int dz = -pad; dz < CHUNK_SIZE + pad; dz++) {
@@ -12,66 +59,154 @@ void create_world(int p, int q, world_func func, void *arg) {
             }
             int x = p * CHUNK_SIZE + dx;
             int z = q * CHUNK_SIZE + dz;
-            float f = simplex2(x * 0.01, z * 0.01, 4, 0.5, 2);
-            float g = simplex2(-x * 0.01, -z * 0.01, 2, 0.9, 2);
-            int mh = g * 32 + 16;
-            int h = f * mh;
-            int w = 1;
-            int t = 12;
-            if (h <= t) {
-                h = t;
-                w = 2;
-            }
+            int i = (dx + pad) * WORLD_SIDE + (dz + pad);
+            int w;
+            int h = _column_height(noise, i, &w);
             // sand and grass terrain
-            for (int y = 0; y < h; y++) {
-                func(x, y, z, w * flag, arg);
-            }
+            _fill(func, fill, arg, x, z, 0, h, w * flag);
             if (w == 1) {
                 if (SHOW_PLANTS) {
                     // grass
-                    if (simplex2(-x * 0.1, z * 0.1, 4, 0.8, 2) > 0.6) {
+                    if (noise->grass[plant] > 0.6) {
                         func(x, h, z, 17 * flag, arg);
                     }
                     // flowers
-                    if (simplex2(x * 0.05, -z * 0.05, 4, 0.8, 2) > 0.7) {
+                    if (noise->flowers[plant++] > 0.7) {
                         int w = 18 + simplex2(x * 0.1, z * 0.1, 4, 0.8, 2) * 7;
                         func(x, h, z, w * flag, arg);
                     }
                 }
                 // trees
-                int ok = SHOW_TREES;
-                if (dx - 4 < 0 || dz - 4 < 0 ||
-                    dx + 4 >= CHUNK_SIZE || dz + 4 >= CHUNK_SIZE)
-                {
-                    ok = 0;
-                }
-                if (ok && simplex2(x, z, 6, 0.5, 2) > 0.84) {
-                    for (int y = h + 3; y < h + 8; y++) {
-                        for (int ox = -3; ox <= 3; ox++) {
-                            for (int oz = -3; oz <= 3; oz++) {
+                int ok = SHOW_TREES && _tree_column(dx, dz);
+                if (ok && noise->trees[tree++] > 0.84) {
+                    // the leaves are a ball, one run per column
+                    for (int ox = -3; ox <= 3; ox++) {
+                        for (int oz = -3; oz <= 3; oz++) {
+                            int y0 = h + 8;
+                            int y1 = h + 3;
+                            for (int y = h + 3; y < h + 8; y++) {
                                 int d = (ox * ox) + (oz * oz) +
                                     (y - (h + 4)) * (y - (h + 4));
                                 if (d < 11) {
-                                    func(x + ox, y, z + oz, 15, arg);
+                                    y0 = y < y0 ? y : y0;
+                                    y1 = y + 1;
                                 }
                             }
+                            if (y0 < y1) {
+                                _fill(func, fill, arg, x + ox, z + oz, y0, y1, 15);
+                            }
                         }
                     }
-                    for (int y = h; y < h + 7; y++) {
-                        func(x, y, z, 5, arg);
-                    }
+                    _fill(func, fill, arg, x, z, h, h + 7, 5);
                 }
             }
             // clouds
             if (SHOW_CLOUDS) {
-                for (int y = 64; y < 72; y++) {
-                    if (simplex3(
-                        x * 0.01, y * 0.1, z * 0.01, 8, 0.5, 2) > 0.75)
-                    {
-                        func(x, y, z, 16 * flag, arg);
+                int y0 = 64;
+                for (int y = 64; y <= 72; y++) {
+                    if (y < 72 && noise->clouds[y - 64][i] > 0.75) {
+                        continue;
+                    }
+                    if (y0 < y) {
+                        _fill(func, fill, arg, x, z, y0, y, 16 * flag);
                     }
+                    y0 = y + 1;
                 }
             }
         }
     }
+    free(noise);
+}
+
+// INTERNAL HELPERS IMPLEMENTATIONS //
+// The inputs are converted to float exactly as the scalar simplex2 calls
+// converted them, and the batch results match those calls bit for bit, so
+// the world does too.
+static void _compute_noise(WorldNoise *noise, int p, int q) {
+    _noise2(noise, p, q, NULL, WORLD_COLUMNS, 0.01, 0.01,
+        noise->f, 4, 0.5, 2);
+    _noise2(noise, p, q, NULL, WORLD_COLUMNS, -0.01, -0.01,
+        noise->g, 2, 0.9, 2);
+    int land = 0;
+    int trees = 0;
+    for (int i = 0; i < WORLD_COLUMNS; i++) {
+        int w;
+        _column_height(noise, i, &w);
+        if (w == 1) {
+            noise->land[land++] = i;
+            if (_tree_column(i / WORLD_SIDE - 1, i % WORLD_SIDE - 1)) {
+                noise->tree_land[trees++] = i;
+            }
+        }
+    }
+    if (SHOW_PLANTS) {
+        _noise2(noise, p, q, noise->land, land, -0.1, 0.1,
+            noise->grass, 4, 0.8, 2);
+        _noise2(noise, p, q, noise->land, land, 0.05, -0.05,
+            noise->flowers, 4, 0.8, 2);
+    }
+    if (SHOW_TREES) {
+        _noise2(noise, p, q, noise->tree_land, trees, 1, 1,
+            noise->trees, 6, 0.5, 2);
+    }
+    if (SHOW_CLOUDS) {
+        for (int layer = 0; layer < CLOUD_LAYERS; layer++) {
+            int y = 64 + layer;
+            for (int i = 0; i < WORLD_COLUMNS; i++) {
+                int x = p * CHUNK_SIZE + i / WORLD_SIDE - 1;
+                int z = q * CHUNK_SIZE + i % WORLD_SIDE - 1;
+                noise->x[i] = x * 0.01;
+                noise->y[i] = y * 0.1;
+                noise->z[i] = z * 0.01;
+            }
+            simplex3_batch(noise->x, noise->y, noise->z, noise->clouds[layer],
+                WORLD_COLUMNS, 8, 0.5, 2);
+        }
+    }
+}
+
+// simplex2 of x * sx, z * sz for the listed columns, or all of them
+static void _noise2(WorldNoise *noise, int p, int q,
+    const int *columns, int count, double sx, double sz,
+    float *out, int octaves, float persistence, float lacunarity)
+{
+    for (int n = 0; n < count; n++) {
+        int i = columns ? columns[n] : n;
+        int x = p * CHUNK_SIZE + i / WORLD_SIDE - 1;
+        int z = q * CHUNK_SIZE + i % WORLD_SIDE - 1;
+        noise->x[n] = x * sx;
+        noise->z[n] = z * sz;
+    }
+    simplex2_batch(noise->x, noise->z, out, count,
+        octaves, persistence, lacunarity);
+}
+
+static int _column_height(WorldNoise *noise, int i, int *w) {
+    int mh = noise->g[i] * 32 + 16;
+    int h = noise->f[i] * mh;
+    int t = 12;
+    *w = 1;
+    if (h <= t) {
+        h = t;
+        *w = 2;
+    }
+    return h;
+}
+
+// trees stay 4 blocks inside the chunk so their leaves do too
+static int _tree_column(int dx, int dz) {
+    return dx - 4 >= 0 && dz - 4 >= 0 &&
+        dx + 4 < CHUNK_SIZE && dz + 4 < CHUNK_SIZE;
+}
+
+static void _fill(world_func func, world_fill_func fill, void *arg,
+    int x, int z, int y0, int y1, int w)
+{
+    if (fill) {
+        fill(x, z, y0, y1, w, arg);
+        return;
+    }
+    for (int y = y0; y < y1; y++) {
+        func(x, y, z, w, arg);
+    }
 }
@@ -2,7 +2,11 @@
 #define _world_h_
 
 typedef void (*world_func)(int, int, int, int, void *);
+// sets y0 <= y < y1 of the column at x, z to w
+typedef void (*world_fill_func)(int x, int z, int y0, int y1, int w, void *arg);
 
 void create_world(int p, int q, world_func func, void *arg);
+void create_world_columns(
+    int p, int q, world_func func, world_fill_func fill, void *arg);
 
 #endif
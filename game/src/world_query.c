@@ -9,7 +9,7 @@
 static int collide(const WorldQuery *world, int height, float *x, float *y, float *z);
 static void get_sight_vector(float rx, float ry, float *vx, float *vy, float *vz);
 static int _hit_test(
-    Map *map, float max_distance, int previous, float x, float y, float z,
+    BlockStore *blocks, float max_distance, int previous, float x, float y, float z,
     float vx, float vy, float vz,
     int *hx, int *hy, int *hz);
 // ========
@@ -43,15 +43,15 @@ int world_get_highest_block(const WorldQuery *world, float x, float z) {
     Chunk *chunk = chunk_manager_find_chunk(world->world_context, p, q);
     if (chunk)
     {
-        Map *map = &chunk->map;
-        MAP_FOR_EACH(map, ex, ey, ez, ew)
+        BlockStore *blocks = &chunk->blocks;
+        for (int y = 255; y >= 0; y--)
         {
-            if (is_obstacle(ew) && ex == nx && ez == nz)
+            if (is_obstacle(block_store_get(blocks, nx, y, nz)))
             {
-                result = MAX(result, ey);
+                result = y;
+                break;
             }
         }
-        END_MAP_FOR_EACH;
     }
     return result;
 }
@@ -154,7 +154,7 @@ int world_hit_test(
             continue;
         }
         int hx, hy, hz;
-        int hw = _hit_test(&chunk->map, 8, previous,
+        int hw = _hit_test(&chunk->blocks, 8, previous,
                            x, y, z, vx, vy, vz, &hx, &hy, &hz);
         if (hw > 0)
         {
@@ -179,8 +179,8 @@ int world_get_block(const WorldQuery *world, int x, int y, int z)
     Chunk *chunk = chunk_manager_find_chunk(world->world_context, p, q);
     if (chunk)
     {
-        Map *map = &chunk->map;
-        return map_get(map, x, y, z);
+        BlockStore *blocks = &chunk->blocks;
+        return block_store_get(blocks, x, y, z);
     }
     return 0;
 }
@@ -195,7 +195,7 @@ static int collide(const WorldQuery *world, int height, float *x, float *y, floa
     {
         return result;
     }
-    Map *map = &chunk->map;
+    BlockStore *blocks = &chunk->blocks;
     int nx = roundf(*x);
     int ny = roundf(*y);
     int nz = roundf(*z);
@@ -205,29 +205,29 @@ static int collide(const WorldQuery *world, int height, float *x, float *y, floa
     float pad = 0.25;
     for (int dy = 0; dy < height; dy++)
     {
-        if (px < -pad && is_obstacle(map_get(map, nx - 1, ny - dy, nz)))
+        if (px < -pad && is_obstacle(block_store_get(blocks, nx - 1, ny - dy, nz)))
         {
             *x = nx - pad;
         }
-        if (px > pad && is_obstacle(map_get(map, nx + 1, ny - dy, nz)))
+        if (px > pad && is_obstacle(block_store_get(blocks, nx + 1, ny - dy, nz)))
         {
             *x = nx + pad;
         }
-        if (py < -pad && is_obstacle(map_get(map, nx, ny - dy - 1, nz)))
+        if (py < -pad && is_obstacle(block_store_get(blocks, nx, ny - dy - 1, nz)))
         {
             *y = ny - pad;
             result = 1;
         }
-        if (py > pad && is_obstacle(map_get(map, nx, ny - dy + 1, nz)))
+        if (py > pad && is_obstacle(block_store_get(blocks, nx, ny - dy + 1, nz)))
         {
             *y = ny + pad;
             result = 1;
         }
-        if (pz < -pad && is_obstacle(map_get(map, nx, ny - dy, nz - 1)))
+        if (pz < -pad && is_obstacle(block_store_get(blocks, nx, ny - dy, nz - 1)))
         {
             *z = nz - pad;
         }
-        if (pz > pad && is_obstacle(map_get(map, nx, ny - dy, nz + 1)))
+        if (pz > pad && is_obstacle(block_store_get(blocks, nx, ny - dy, nz + 1)))
         {
             *z = nz + pad;
         }
@@ -241,7 +241,7 @@ static void get_sight_vector(float rx, float ry, float *vx, float *vy, float *vz
     *vz = sinf(rx - RADIANS(90)) * m;
 }
 static int _hit_test(
-    Map *map, float max_distance, int previous,
+    BlockStore *blocks, float max_distance, int previous,
     float x, float y, float z,
     float vx, float vy, float vz,
     int *hx, int *hy, int *hz)
@@ -257,7 +257,7 @@ static int _hit_test(
         int nz = roundf(z);
         if (nx != px || ny != py || nz != pz)
         {
-            int hw = map_get(map, nx, ny, nz);
+            int hw = block_store_get(blocks, nx, ny, nz);
             if (hw > 0)
             {
                 if (previous)